@@ -0,0 +1,1778 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <setjmp.h>
+
+#include "lisp-types.h"
+#include "primitives.h"
+#include "analyze.h"
+#include "builtins.h"
+#include "math.h"
+
+#define C(x) #x,
+char *lisp_nodes_list[] = { LISP_NODES "ln_max" };
+#undef C
+
+#define F(x, name) name,
+static char *s_form_names[] = { LISP_FORMS };
+#undef F
+
+/**
+ * allocate a node of the given type, with room for argc
+ * sub-nodes
+ */
+static lnode_t *s_node_new(lisp_node_t type, lnode_fn_t fn,
+                           lv_t *form, int argc) {
+    lnode_t *node = safe_malloc(sizeof(lnode_t));
+
+    node->type = type;
+    node->fn = fn;
+    node->form = form;
+    node->argc = argc;
+
+    if(argc)
+        node->argv = safe_malloc(sizeof(lnode_t *) * argc);
+
+    return node;
+}
+
+/**
+ * count the items following the operator of a form,
+ * enforcing that the form is a proper list
+ */
+static int s_arg_count(lexec_t *exec, lv_t *v) {
+    int count = 0;
+
+    for(v = L_CDR(v); v; v = L_CDR(v)) {
+        rt_assert(v->type == l_pair, le_syntax, "improper form");
+        count++;
+    }
+
+    return count;
+}
+
+
+/*
+ * node handlers
+ */
+
+static lv_t *s_exec_const(lexec_t *exec, lnode_t *node) {
+    return node->value;
+}
+
+/**
+ * look a name up by name from search, through the cache on the
+ * node.  The cache is good while lookups are made from the same
+ * env and nothing has been bound since.
+ */
+static lv_t *s_cached_lookup(lexec_t *exec, lnode_t *node,
+                             lv_t *env, lv_t *search) {
+    lv_t *result;
+
+    if(node->ic_value && node->ic_env == env &&
+       node->ic_version == lisp_env_version) {
+        exec->ic_hits++;
+        return node->ic_value;
+    }
+
+    exec->ic_misses++;
+
+    if(!search || !(result = c_env_lookup(search, node->value))) {
+        /* unbound symbols evaluate to themselves */
+        return node->value;
+    }
+
+    /* region memory is reused, so its address is no key */
+    if(lisp_region_contains(exec, env))
+        return result;
+
+    node->ic_value = result;
+    node->ic_env = env;
+    node->ic_version = lisp_env_version;
+
+    return result;
+}
+
+/**
+ * fetch a name that can only be looked up by name.  The frames
+ * between the node and the root of its scope only ever bind the
+ * names of that scope, so the lookup is cached against the env
+ * at the root.
+ */
+lv_t *lisp_dynamic_lookup(lexec_t *exec, lnode_t *node) {
+    lv_t *env = exec->env;
+    int depth;
+
+    for(depth = node->depth; depth; depth--)
+        env = L_CDR(env);
+
+    return s_cached_lookup(exec, node, env, exec->env);
+}
+
+static lv_t *s_exec_ref(lexec_t *exec, lnode_t *node) {
+    return lisp_dynamic_lookup(exec, node);
+}
+
+/**
+ * fetch a global.  The ref is linked to its binding cell in the
+ * innermost global layer the first time through, adding an
+ * unbound cell if the name is not defined yet.  define fills the
+ * cell in place, so from then on a read is a single load.
+ */
+lv_t *lisp_global_lookup(lexec_t *exec, lnode_t *node) {
+    lv_t *env;
+    int depth;
+
+    if(node->cell && *node->cell) {
+        exec->ic_hits++;
+        return *node->cell;
+    }
+
+    env = exec->env;
+    for(depth = node->depth; depth; depth--)
+        env = L_CDR(env);
+
+    assert(L_CAR(env)->type == l_hash);
+
+    if(!node->cell) {
+        exec->ic_misses++;
+        node->cell = c_hash_cell(L_CAR(env), node->value);
+        if(*node->cell)
+            return *node->cell;
+    }
+
+    /* not bound in the innermost layer, try the rest */
+    return s_cached_lookup(exec, node, env, L_CDR(env));
+}
+
+/**
+ * find what a global is bound to now, from the global layers
+ * under the current env, or NULL.  This is for decisions made
+ * about a node before it runs, when the env may not be the one
+ * it will run in, so the caller must check the binding again
+ * when the node does run.
+ */
+lv_t *lisp_static_global(lexec_t *exec, lnode_t *node) {
+    lv_t *env;
+
+    assert(exec && node && node->type == ln_global);
+
+    for(env = exec->env; env && L_CAR(env)->type != l_hash;
+        env = L_CDR(env));
+
+    return env ? c_env_lookup(env, node->value) : NULL;
+}
+
+static lv_t *s_exec_global(lexec_t *exec, lnode_t *node) {
+    return lisp_global_lookup(exec, node);
+}
+
+/**
+ * fetch a lexically addressed variable: skip straight to its
+ * frame and slot, falling back to a search by name from there
+ * if the slot is not bound (yet)
+ */
+lv_t *lisp_local_lookup(lexec_t *exec, lnode_t *node) {
+    lv_t *env = exec->env;
+    lv_t *frame, *result;
+    int depth;
+
+    for(depth = node->depth; depth; depth--)
+        env = L_CDR(env);
+
+    frame = L_CAR(env);
+    assert(frame->type == l_frame);
+
+    if(node->slot < L_FRAME_COUNT(frame) &&
+       (result = L_FRAME_SLOT(frame, node->slot)))
+        return result;
+
+    if((result = c_env_lookup(env, node->value)))
+        return result;
+
+    return node->value;
+}
+
+static lv_t *s_exec_local(lexec_t *exec, lnode_t *node) {
+    return lisp_local_lookup(exec, node);
+}
+
+static lv_t *s_exec_define(lexec_t *exec, lnode_t *node) {
+    lv_t *result;
+
+    result = lisp_exec_node(exec, node->argv[0]);
+    if(result->type == l_fn && !L_FN_BOUND(result))
+        L_FN_BOUND(result) = node->value;
+
+    return lisp_define(exec, node->value, result);
+}
+
+/**
+ * make the env of a flat closure: a frame holding just the
+ * variables the lambda uses from its enclosing frames, over the
+ * globals.  The enclosing frames themselves are not kept.
+ */
+static lv_t *s_closure_env(lexec_t *exec, lnode_t *node) {
+    lv_t *env = exec->env;
+    lv_t *frame = NULL;
+    int index;
+
+    if(node->argc) {
+        frame = lisp_create_frame(node->scope->next);
+        for(index = 0; index < node->argc; index++)
+            L_FRAME_SLOT(frame, index) = lisp_exec_node(exec,
+                                                        node->argv[index]);
+    }
+
+    for(index = node->depth; index; index--)
+        env = L_CDR(env);
+
+    return frame ? lisp_create_pair(frame, env) : env;
+}
+
+static lv_t *s_exec_lambda(lexec_t *exec, lnode_t *node) {
+    lv_t *result;
+
+    result = lisp_create_lambda(exec, node->value, L_CADDR(node->form));
+    if(node->depth)
+        L_FN_ENV(result) = s_closure_env(exec, node);
+    else
+        lisp_region_pin(exec, L_FN_ENV(result));
+
+    L_FN_CODE(result) = node->body;
+    L_FN_SCOPE(result) = node->scope;
+    return result;
+}
+
+static lv_t *s_exec_defmacro(lexec_t *exec, lnode_t *node) {
+    lv_t *macro;
+
+    macro = lisp_create_macro(exec, node->value, L_CADDDR(node->form));
+    L_FN_CODE(macro) = node->body;
+    L_FN_SCOPE(macro) = node->scope;
+
+    return lisp_define(exec, L_CADR(node->form), macro);
+}
+
+static lv_t *s_exec_begin(lexec_t *exec, lnode_t *node) {
+    int index;
+
+    for(index = 0; index < node->argc - 1; index++)
+        lisp_exec_node(exec, node->argv[index]);
+
+    return lisp_tail_node(exec, node->argv[node->argc - 1]);
+}
+
+static lv_t *s_exec_quasiquote(lexec_t *exec, lnode_t *node) {
+    lv_t *values[node->argc + 1];
+    lnode_t *sub;
+    int index;
+
+    for(index = 0; index < node->argc; index++) {
+        sub = node->argv[index];
+        values[index] = lisp_exec_node(exec, sub->type == ln_splice ?
+                                       sub->body : sub);
+    }
+
+    if(node->body)
+        values[node->argc] = lisp_exec_node(exec, node->body);
+
+    return lisp_quasi_build(exec, node, values);
+}
+
+static lv_t *s_exec_if(lexec_t *exec, lnode_t *node) {
+    lv_t *test;
+
+    test = lisp_exec_node(exec, node->argv[0]);
+
+    if(test == LISP_FALSE)
+        return lisp_tail_node(exec, node->argv[2]);
+    return lisp_tail_node(exec, node->argv[1]);
+}
+
+static lv_t *s_exec_let(lexec_t *exec, lnode_t *node) {
+    lv_t *frame;
+    int index;
+
+    frame = lisp_create_frame(node->scope);
+
+    for(index = 0; index < node->argc; index++)
+        L_FRAME_SLOT(frame, index) = lisp_exec_node(exec, node->argv[index]);
+
+    /* the trampoline restores the env when the body is done */
+    exec->env = lisp_create_pair(frame, exec->env);
+    return lisp_tail_node(exec, node->body);
+}
+
+static lv_t *s_exec_let_star(lexec_t *exec, lnode_t *node) {
+    lv_t *frame;
+    int index;
+
+    frame = lisp_create_frame(node->scope);
+    exec->env = lisp_create_pair(frame, exec->env);
+
+    for(index = 0; index < node->argc; index++)
+        L_FRAME_SLOT(frame, index) = lisp_exec_node(exec, node->argv[index]);
+
+    return lisp_tail_node(exec, node->body);
+}
+
+static lv_t *s_exec_apply(lexec_t *exec, lnode_t *node) {
+    lv_t *argv[node->argc + 1];
+    lv_t *fn, *result;
+    int index;
+
+    fn = lisp_exec_node(exec, node->body);
+
+    /* macros get the unevaluated forms, and the expansion
+     * is evaluated in place of the call */
+    if(fn->type == l_fn && L_FN_FTYPE(fn) == lf_macro)
+        return lisp_tail_node(exec, lisp_expand_node(exec, node, fn));
+
+    for(index = 0; index < node->argc; index++)
+        argv[index] = lisp_exec_node(exec, node->argv[index]);
+
+    rt_assert(fn->type == l_fn, le_type, "eval a non-function");
+
+    if(L_FN_FTYPE(fn) == lf_lambda) {
+        lisp_check_arity(exec, fn, node->argc);
+        return lisp_tail_call(exec, fn, c_array_to_list(node->argc, argv));
+    }
+
+    if(node->site && L_FN_FTYPE(fn) == lf_native &&
+       (result = math_site_op(exec, &node->site, fn, node->argc, argv)))
+        return result;
+
+    return lisp_exec_argv(exec, fn, node->argc, argv);
+}
+
+/**
+ * check that the primitives a fold node was folded with are
+ * still bound where the call and any folded arguments look them
+ * up.  If one has been rebound, the fold no longer holds, and
+ * the node goes back to being an ordinary call for good.
+ */
+int lisp_fold_valid(lexec_t *exec, lnode_t *node) {
+    int index;
+
+    assert(exec && node);
+
+    if(node->type != ln_fold)
+        return 0;
+
+    if(lisp_global_lookup(exec, node->body) != node->fold_fn)
+        goto unfold;
+
+    for(index = 0; index < node->argc; index++)
+        if(node->argv[index]->type != ln_const &&
+           !lisp_fold_valid(exec, node->argv[index]))
+            goto unfold;
+
+    return 1;
+
+unfold:
+    node->type = ln_apply;
+    node->fn = s_exec_apply;
+    return 0;
+}
+
+static lv_t *s_exec_fold(lexec_t *exec, lnode_t *node) {
+    if(lisp_fold_valid(exec, node))
+        return node->value;
+
+    return s_exec_apply(exec, node);
+}
+
+/**
+ * assign to the variable a set! node resolved to.  Locals and
+ * linked globals are stored straight into their slot or cell.
+ */
+lv_t *lisp_set_node(lexec_t *exec, lnode_t *node, lv_t *value) {
+    lnode_t *target = node->body;
+    lv_t *env, *frame;
+    int depth;
+
+    switch(target->type) {
+    case ln_local:
+        env = exec->env;
+        for(depth = target->depth; depth; depth--)
+            env = L_CDR(env);
+
+        frame = L_CAR(env);
+        if(target->slot < L_FRAME_COUNT(frame) &&
+           L_FRAME_SLOT(frame, target->slot)) {
+            L_FRAME_SLOT(frame, target->slot) = value;
+            lisp_env_version++;
+            return lisp_create_null();
+        }
+        break;
+    case ln_global:
+        if(target->cell && *target->cell) {
+            *target->cell = value;
+            lisp_env_version++;
+            return lisp_create_null();
+        }
+        break;
+    default:
+        break;
+    }
+
+    return lisp_set(exec, node->value, value);
+}
+
+static lv_t *s_exec_set(lexec_t *exec, lnode_t *node) {
+    return lisp_set_node(exec, node, lisp_exec_node(exec, node->argv[0]));
+}
+
+static lv_t *s_exec_and(lexec_t *exec, lnode_t *node) {
+    lv_t *value;
+    int index;
+
+    for(index = 0; index < node->argc - 1; index++) {
+        value = lisp_exec_node(exec, node->argv[index]);
+        if(value == LISP_FALSE)
+            return value;
+    }
+
+    return lisp_tail_node(exec, node->argv[node->argc - 1]);
+}
+
+static lv_t *s_exec_or(lexec_t *exec, lnode_t *node) {
+    lv_t *value;
+    int index;
+
+    for(index = 0; index < node->argc - 1; index++) {
+        value = lisp_exec_node(exec, node->argv[index]);
+        if(value != LISP_FALSE)
+            return value;
+    }
+
+    return lisp_tail_node(exec, node->argv[node->argc - 1]);
+}
+
+/**
+ * find the clause of a case node that matches key, returning its
+ * index in argv, or 0 if no clause matches
+ */
+int lisp_case_select(lexec_t *exec, lnode_t *node, lv_t *key) {
+    lv_t *clause, *datum;
+    int index = 1;
+
+    for(clause = node->value; clause; clause = L_CDR(clause), index++) {
+        /* else */
+        if(L_CAR(clause)->type == l_sym)
+            return index;
+
+        if(L_CAR(clause)->type != l_pair)
+            continue;
+
+        for(datum = L_CAR(clause); datum; datum = L_CDR(datum))
+            if(c_equalp(key, L_CAR(datum)))
+                return index;
+    }
+
+    return 0;
+}
+
+static lv_t *s_exec_case(lexec_t *exec, lnode_t *node) {
+    int index;
+
+    index = lisp_case_select(exec, node, lisp_exec_node(exec, node->argv[0]));
+    if(!index)
+        return lisp_create_null();
+
+    return lisp_tail_node(exec, node->argv[index]);
+}
+
+/**
+ * do loops.  argv holds the test, the result, the commands, then
+ * the inits and steps of each variable.  Each pass binds the
+ * steps in a fresh frame, so closures made in the body keep the
+ * values of their own pass.
+ */
+static lv_t *s_exec_do(lexec_t *exec, lnode_t *node) {
+    int count = (node->argc - 3) / 2;
+    lnode_t **inits = node->argv + 3;
+    lnode_t **steps = inits + count;
+    lv_t *frame, *test;
+    int index;
+
+    frame = lisp_create_frame(node->scope);
+    for(index = 0; index < count; index++)
+        L_FRAME_SLOT(frame, index) = lisp_exec_node(exec, inits[index]);
+
+    /* the trampoline restores the env when the result is done */
+    exec->env = lisp_create_pair(frame, exec->env);
+
+    while(1) {
+        test = lisp_exec_node(exec, node->argv[0]);
+        if(test != LISP_FALSE)
+            return lisp_tail_node(exec, node->argv[1]);
+
+        lisp_exec_node(exec, node->argv[2]);
+
+        frame = lisp_create_frame(node->scope);
+        for(index = 0; index < count; index++)
+            L_FRAME_SLOT(frame, index) = lisp_exec_node(exec, steps[index]);
+
+        exec->env = lisp_create_pair(frame, L_CDR(exec->env));
+    }
+}
+
+/*
+ * static scope
+ */
+
+/**
+ * the root of the scope for code analyzed to run in an env that
+ * is not just global layers.  Names not bound lexically are
+ * looked up by name under it, rather than linked to a global.
+ */
+static lscope_t s_dynamic_scope;
+
+static lscope_t *s_root_scope(lv_t *env) {
+    for(; env; env = L_CDR(env))
+        if(L_CAR(env)->type != l_hash)
+            return &s_dynamic_scope;
+
+    return NULL;
+}
+
+/**
+ * add a name to a scope frame, returning its slot
+ */
+static int s_scope_add(lscope_t *scope, lv_t *sym) {
+    lv_t *item = lisp_create_pair(sym, NULL);
+    lv_t *vptr;
+
+    if(!scope->names) {
+        scope->names = item;
+    } else {
+        for(vptr = scope->names; L_CDR(vptr); vptr = L_CDR(vptr));
+        L_CDR(vptr) = item;
+    }
+
+    return scope->count++;
+}
+
+/**
+ * open a scope frame for the symbols bound by formals, which
+ * may be a list, an improper list, or a single symbol
+ */
+static lscope_t *s_scope_new(lv_t *formals, lscope_t *next) {
+    lscope_t *scope = safe_malloc(sizeof(lscope_t));
+
+    scope->next = next;
+
+    while(formals && formals->type == l_pair) {
+        s_scope_add(scope, L_CAR(formals));
+        formals = L_CDR(formals);
+    }
+
+    if(formals && formals->type == l_sym)
+        s_scope_add(scope, formals);
+
+    /* formals are always bound by the call */
+    scope->fixed = scope->count;
+
+    return scope;
+}
+
+/**
+ * find the slot of a symbol in a single scope frame, or -1.  A
+ * let* may bind a name twice: the latest binding made so far
+ * wins, and one not made yet is only taken if there is no other.
+ */
+static int s_scope_slot(lscope_t *scope, lv_t *sym) {
+    lv_t *vptr = scope->names;
+    int slot, found = -1, pending = -1;
+
+    for(slot = 0; slot < scope->count; slot++, vptr = L_CDR(vptr)) {
+        if(strcmp(L_SYM(L_CAR(vptr)), L_SYM(sym)))
+            continue;
+
+        if(slot >= scope->hide && slot < scope->hide_end) {
+            if(pending == -1)
+                pending = slot;
+        } else {
+            found = slot;
+        }
+    }
+
+    return found != -1 ? found : pending;
+}
+
+/**
+ * add the names of the internal defines in a body form, including
+ * those in begins at its top, to the frame it runs in.  They are
+ * bound before the body is analyzed, so uses ahead of the define
+ * (mutual recursion, say) find the slot too.
+ */
+static void s_scope_defines(lscope_t *scope, lv_t *v) {
+    lv_t *vptr;
+
+    if(v->type != l_pair || L_CAR(v)->type != l_sym)
+        return;
+
+    if(L_SYM_FORM(L_CAR(v)) == lsf_begin) {
+        for(vptr = L_CDR(v); vptr && vptr->type == l_pair; vptr = L_CDR(vptr))
+            s_scope_defines(scope, L_CAR(vptr));
+        return;
+    }
+
+    if(L_SYM_FORM(L_CAR(v)) == lsf_define && L_CDR(v) &&
+       L_CDR(v)->type == l_pair && L_CADR(v)->type == l_sym &&
+       s_scope_slot(scope, L_CADR(v)) == -1)
+        s_scope_add(scope, L_CADR(v));
+}
+
+static lnode_t *s_analyze(lexec_t *exec, lscope_t *scope, lv_t *v);
+
+/*
+ * analyzers for the special forms
+ */
+
+static lnode_t *s_analyze_const(lv_t *form, lv_t *value) {
+    lnode_t *node = s_node_new(ln_const, s_exec_const, form, 0);
+    node->value = value;
+    return node;
+}
+
+static void s_check_formals(lexec_t *exec, lv_t *formals) {
+    rt_assert(formals->type == l_pair ||
+              formals->type == l_null ||
+              formals->type == l_sym, le_type,
+              "formals must be a list, symbol, or ()");
+}
+
+static lnode_t *s_analyze_quote(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    rt_assert(s_arg_count(exec, v) == 1, le_arity, "quote arity");
+    return s_analyze_const(v, L_CADR(v));
+}
+
+static lnode_t *s_analyze_define(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+
+    rt_assert(s_arg_count(exec, v) == 2, le_arity, "define arity");
+    rt_assert(L_CADR(v)->type == l_sym, le_type, "cannot define non-symbol");
+
+    /* internal defines bind in the innermost frame */
+    if(scope && scope != &s_dynamic_scope && s_scope_slot(scope, L_CADR(v)) == -1)
+        s_scope_add(scope, L_CADR(v));
+
+    node = s_node_new(ln_define, s_exec_define, v, 1);
+    node->value = L_CADR(v);
+    node->argv[0] = s_analyze(exec, scope, L_CADDR(v));
+
+    return node;
+}
+
+/**
+ * does form v (outside of quoted data) assign sym, by set! or
+ * by define?
+ */
+static int s_assigns(lv_t *v, lv_t *sym) {
+    lv_t *op;
+
+    for(; v && v->type == l_pair; v = L_CDR(v)) {
+        op = L_CAR(v);
+        if(op->type == l_sym && L_SYM_FORM(op) == lsf_quote)
+            return 0;
+
+        if(op->type == l_sym && (L_SYM_FORM(op) == lsf_set ||
+                                 L_SYM_FORM(op) == lsf_define) &&
+           L_CDR(v) && L_CDR(v)->type == l_pair &&
+           L_CADR(v)->type == l_sym && !strcmp(L_SYM(L_CADR(v)), L_SYM(sym)))
+            return 1;
+
+        if(s_assigns(op, sym))
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * add the variables of the enclosing scope that the symbols in
+ * v (outside of quoted data) could refer to, to the flat scope.
+ * Names bound by the lambda itself are skipped.  Returns 0 if
+ * one of them can't be copied: it may be unbound when the
+ * closure is made, or assigned after.
+ */
+static int s_capture(lscope_t *outer, lscope_t *own, lscope_t *flat, lv_t *v) {
+    lscope_t *scope;
+    int slot;
+
+    if(v->type == l_sym) {
+        if(s_scope_slot(own, v) != -1)
+            return 1;
+
+        for(scope = outer; scope; scope = scope->next) {
+            if((slot = s_scope_slot(scope, v)) == -1)
+                continue;
+
+            if(slot >= scope->fixed || !scope->form ||
+               s_assigns(scope->form, v))
+                return 0;
+
+            if(s_scope_slot(flat, v) == -1)
+                s_scope_add(flat, v);
+
+            return 1;
+        }
+
+        return 1;
+    }
+
+    if(v->type != l_pair)
+        return 1;
+
+    if(L_CAR(v)->type == l_sym && L_SYM_FORM(L_CAR(v)) == lsf_quote)
+        return 1;
+
+    for(; v && v->type == l_pair; v = L_CDR(v))
+        if(!s_capture(outer, own, flat, L_CAR(v)))
+            return 0;
+
+    return !v || s_capture(outer, own, flat, v);
+}
+
+/**
+ * make a lambda node a flat closure, if its free variables can
+ * be found statically.  The body is then analyzed against a
+ * scope holding just those variables, and the closure copies
+ * their values when it is made rather than keeping the frames
+ * they live in.
+ */
+static void s_flatten(lexec_t *exec, lscope_t *scope, lnode_t *node) {
+    lscope_t *flat, *sptr;
+    lv_t *vptr;
+    int depth = 0;
+    int index;
+
+    /* at top level there is nothing to leave out */
+    for(sptr = scope; sptr; sptr = sptr->next, depth++)
+        if(sptr == &s_dynamic_scope)
+            return;
+
+    if(!depth)
+        return;
+
+    flat = s_scope_new(NULL, NULL);
+    if(!s_capture(scope, node->scope, flat, L_CADDR(node->form)))
+        return;
+
+    flat->fixed = flat->count;
+    flat->form = node->form;
+
+    node->scope->next = flat->count ? flat : NULL;
+    node->depth = depth;
+    node->argc = flat->count;
+    node->argv = safe_malloc(sizeof(lnode_t *) * (flat->count + 1));
+
+    for(index = 0, vptr = flat->names; vptr; vptr = L_CDR(vptr))
+        node->argv[index++] = s_analyze(exec, scope, L_CAR(vptr));
+}
+
+/**
+ * can a node let the frame it runs in outlive the call?  Only a
+ * closure that keeps its env (one that isn't flat), or a macro,
+ * holds on to the frames under it.  Anything made by macro uses
+ * expanded as the code runs is caught by lisp_region_pin.
+ */
+static int s_escapes(lnode_t *node) {
+    int index;
+
+    if(!node)
+        return 0;
+
+    if(node->type == ln_lambda)
+        return !node->depth;
+
+    if(node->type == ln_defmacro || s_escapes(node->body))
+        return 1;
+
+    for(index = 0; index < node->argc; index++)
+        if(s_escapes(node->argv[index]))
+            return 1;
+
+    return 0;
+}
+
+/**
+ * could a call under a node still turn out to be a macro use when
+ * it runs?  Its expansion is analyzed then, against the scope of
+ * the call, so it may use any variable in sight, not just the ones
+ * a flat closure copies.  That is the case for a global operator
+ * not bound to a plain function yet (a macro defined later), or
+ * bound to a macro that was left for run time (a dynamic macro).
+ */
+static int s_late_macro(lexec_t *exec, lnode_t *node) {
+    lv_t *fn;
+    int index;
+
+    if(!node)
+        return 0;
+
+    if(node->type == ln_apply && node->body->type == ln_global) {
+        fn = lisp_static_global(exec, node->body);
+        if(!fn || fn->type != l_fn || L_FN_FTYPE(fn) == lf_macro)
+            return 1;
+    }
+
+    if(s_late_macro(exec, node->body))
+        return 1;
+
+    for(index = 0; index < node->argc; index++)
+        if(s_late_macro(exec, node->argv[index]))
+            return 1;
+
+    return 0;
+}
+
+static lnode_t *s_analyze_lambda(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+
+    rt_assert(s_arg_count(exec, v) == 2, le_arity, "lambda arity");
+    s_check_formals(exec, L_CADR(v));
+
+    node = s_node_new(ln_lambda, s_exec_lambda, v, 0);
+    node->value = L_CADR(v);
+    node->scope = s_scope_new(L_CADR(v), scope);
+    node->scope->form = v;
+    s_scope_defines(node->scope, L_CADDR(v));
+    s_flatten(exec, scope, node);
+    node->body = s_analyze(exec, node->scope, L_CADDR(v));
+
+    /* a late macro use needs the frames a flat closure leaves out */
+    if(node->depth && s_late_macro(exec, node->body)) {
+        node->scope->next = scope;
+        node->depth = node->argc = 0;
+        node->body = s_analyze(exec, node->scope, L_CADDR(v));
+    }
+    node->scope->transient = !s_escapes(node->body);
+
+    return node;
+}
+
+static lnode_t *s_analyze_defmacro(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+
+    rt_assert(s_arg_count(exec, v) == 3, le_arity, "defmacro arity");
+    rt_assert(L_CADR(v)->type == l_sym, le_type,
+              "defmacro wrong type for name");
+    s_check_formals(exec, L_CADDR(v));
+
+    node = s_node_new(ln_defmacro, s_exec_defmacro, v, 0);
+    node->value = L_CADDR(v);
+    node->scope = s_scope_new(L_CADDR(v), scope);
+    node->scope->form = v;
+    node->body = s_analyze(exec, node->scope, L_CADDDR(v));
+
+    return node;
+}
+
+/**
+ * analyze the sequence of forms in body (part of form v), which
+ * has the value of its last form, or () if it is empty
+ */
+static lnode_t *s_analyze_body(lexec_t *exec, lscope_t *scope,
+                               lv_t *v, lv_t *body) {
+    lnode_t *node;
+    lv_t *vptr;
+    int count = 0;
+
+    if(!body || body->type == l_null)
+        return s_analyze_const(v, lisp_create_null());
+
+    for(vptr = body; vptr; vptr = L_CDR(vptr)) {
+        rt_assert(vptr->type == l_pair, le_syntax, "improper form");
+        count++;
+    }
+
+    if(count == 1)
+        return s_analyze(exec, scope, L_CAR(body));
+
+    node = s_node_new(ln_begin, s_exec_begin, v, count);
+    for(count = 0, vptr = body; vptr; vptr = L_CDR(vptr))
+        node->argv[count++] = s_analyze(exec, scope, L_CAR(vptr));
+
+    return node;
+}
+
+static lnode_t *s_analyze_begin(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+    lv_t *vptr;
+    int index = 0;
+
+    rt_assert(s_arg_count(exec, v) >= 1, le_arity, "begin arity");
+
+    node = s_node_new(ln_begin, s_exec_begin, v, s_arg_count(exec, v));
+    for(vptr = L_CDR(v); vptr; vptr = L_CDR(vptr))
+        node->argv[index++] = s_analyze(exec, scope, L_CAR(vptr));
+
+    return node;
+}
+
+static int s_is_tagged(lv_t *v, char *tag) {
+    return (v->type == l_pair &&
+            L_CAR(v)->type == l_sym &&
+            !strcmp(L_SYM(L_CAR(v)), tag));
+}
+
+/**
+ * quasiquote templates are analyzed into list constructors,
+ * with unquoted terms analyzed as ordinary expressions
+ */
+static lnode_t *s_analyze_template(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node, *sub;
+    lv_t *vptr;
+    int count = 0;
+    int index = 0;
+
+    if(v->type != l_pair)
+        return s_analyze_const(v, v);
+
+    if(s_is_tagged(v, "unquote")) {
+        rt_assert(s_arg_count(exec, v) == 1, le_arity, "unquote arity");
+        return s_analyze(exec, scope, L_CADR(v));
+    }
+
+    for(vptr = v; vptr && vptr->type == l_pair; vptr = L_CDR(vptr))
+        count++;
+
+    node = s_node_new(ln_quasiquote, s_exec_quasiquote, v, count);
+
+    for(vptr = v; vptr && vptr->type == l_pair; vptr = L_CDR(vptr)) {
+        if(s_is_tagged(L_CAR(vptr), "unquote-splicing")) {
+            rt_assert(s_arg_count(exec, L_CAR(vptr)) == 1, le_arity,
+                      "unquote-splicing arity");
+            sub = s_node_new(ln_splice, NULL, L_CAR(vptr), 0);
+            sub->body = s_analyze(exec, scope, L_CADR(L_CAR(vptr)));
+        } else {
+            sub = s_analyze_template(exec, scope, L_CAR(vptr));
+        }
+        node->argv[index++] = sub;
+    }
+
+    /* dotted tail */
+    if(vptr)
+        node->body = s_analyze_template(exec, scope, vptr);
+
+    return node;
+}
+
+static lnode_t *s_analyze_quasiquote(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    rt_assert(s_arg_count(exec, v) == 1, le_arity, "quasiquote arity");
+    return s_analyze_template(exec, scope, L_CADR(v));
+}
+
+static lnode_t *s_analyze_if(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+
+    rt_assert(s_arg_count(exec, v) == 3, le_arity, "if arity");
+
+    node = s_node_new(ln_if, s_exec_if, v, 3);
+    node->argv[0] = s_analyze(exec, scope, L_CADR(v));    // expression
+    node->argv[1] = s_analyze(exec, scope, L_CADDR(v));   // value if true
+    node->argv[2] = s_analyze(exec, scope, L_CADDDR(v));  // value if false
+
+    return node;
+}
+
+static lnode_t *s_analyze_let(lexec_t *exec, lscope_t *scope, lv_t *v,
+                              int star) {
+    lnode_t *node;
+    lv_t *args, *argp;
+    int index = 0;
+
+    rt_assert(s_arg_count(exec, v) == 2, le_arity, "let arity");
+
+    args = L_CADR(v);               // tuple assignment list
+    rt_assert(args->type == l_null ||
+              args->type == l_pair, le_type,
+              "let arg type");
+
+    node = s_node_new(star ? ln_let_star : ln_let,
+                      star ? s_exec_let_star : s_exec_let,
+                      v, args->type == l_pair ? c_list_length(args) : 0);
+
+    /* the bindings take the first slots of the frame, in order */
+    node->scope = s_scope_new(NULL, scope);
+
+    for(argp = args; argp && argp->type == l_pair; argp = L_CDR(argp)) {
+        rt_assert(L_CAR(argp)->type == l_pair &&
+                  c_list_length(L_CAR(argp)) == 2, le_arity,
+                  "let arg arity");
+        rt_assert(L_CAAR(argp)->type == l_sym, le_type,
+                  "let binds symbols");
+
+        s_scope_add(node->scope, L_CAAR(argp));
+    }
+
+    node->scope->form = v;
+    if(!star)
+        node->scope->fixed = node->scope->count;
+
+    /* let* inits run in the new frame, and each sees the
+     * bindings before it over the ones after */
+    for(argp = args; argp && argp->type == l_pair; argp = L_CDR(argp)) {
+        node->scope->hide = index;
+        node->scope->hide_end = node->argc;
+        node->argv[index++] = s_analyze(exec, star ? node->scope : scope,
+                                        L_CADAR(argp));
+    }
+
+    node->scope->hide = node->scope->hide_end = 0;
+
+    s_scope_defines(node->scope, L_CADDR(v));
+    node->body = s_analyze(exec, node->scope, L_CADDR(v));  // eval under let
+
+    return node;
+}
+
+/**
+ * fold a call of a pure primitive on constant arguments, running
+ * it now and keeping the result on the node.  The operator must
+ * be a global bound to the primitive when the call is analyzed,
+ * and the result is only used while it stays bound.  A call that
+ * raises an error is left to raise it when it runs.
+ */
+static void s_fold(lexec_t *exec, lnode_t *node) {
+    lv_t *argv[node->argc + 1];
+    lv_t *fn, *result;
+    lstack_t *eval_stack;
+    jmp_buf jb;
+    int index;
+
+    if(node->body->type != ln_global)
+        return;
+
+    for(index = 0; index < node->argc; index++) {
+        if(node->argv[index]->type != ln_const &&
+           node->argv[index]->type != ln_fold)
+            return;
+        argv[index] = node->argv[index]->value;
+    }
+
+    fn = lisp_static_global(exec, node->body);
+    if(!fn || fn->type != l_fn || L_FN_FTYPE(fn) != lf_native ||
+       !L_FN_PURE(fn))
+        return;
+
+    eval_stack = exec->eval_stack;
+    lisp_exec_push_ex(exec, &jb);
+
+    if(setjmp(jb) == 0) {
+        result = lisp_exec_argv(exec, fn, node->argc, argv);
+        lisp_exec_pop_ex(exec);
+
+        node->type = ln_fold;
+        node->fn = s_exec_fold;
+        node->value = result;
+        node->fold_fn = fn;
+        return;
+    }
+
+    exec->eval_stack = eval_stack;
+    exec->exc = le_success;
+    exec->msg = NULL;
+}
+
+static lnode_t *s_analyze_apply(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+    lv_t *vptr;
+    int index = 0;
+
+    node = s_node_new(ln_apply, s_exec_apply, v, s_arg_count(exec, v));
+    node->scope = scope;  /* for analyzing macro expansions */
+    node->body = s_analyze(exec, scope, L_CAR(v));
+
+    for(vptr = L_CDR(v); vptr; vptr = L_CDR(vptr))
+        node->argv[index++] = s_analyze(exec, scope, L_CAR(vptr));
+
+    s_fold(exec, node);
+
+    /* only calls of the primitives math_site_op specializes get
+     * type feedback, the rest go straight to the primitive */
+    if(node->type == ln_apply && node->argc == 2 &&
+       node->body->type == ln_global)
+        node->site = math_site_new(lisp_static_global(exec, node->body));
+
+    return node;
+}
+
+static lnode_t *s_analyze_symbol(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+    int depth, slot;
+
+    /* variables bound by an enclosing lambda or let are
+     * addressed by frame depth and slot */
+    for(depth = 0; scope; depth++, scope = scope->next) {
+        if(scope == &s_dynamic_scope) {
+            node = s_node_new(ln_ref, s_exec_ref, v, 0);
+            node->value = v;
+            node->depth = depth;
+            return node;
+        }
+
+        if((slot = s_scope_slot(scope, v)) != -1) {
+            node = s_node_new(ln_local, s_exec_local, v, 0);
+            node->value = v;
+            node->depth = depth;
+            node->slot = slot;
+            return node;
+        }
+    }
+
+    /* everything else is a global, depth frames out */
+    node = s_node_new(ln_global, s_exec_global, v, 0);
+    node->value = v;
+    node->depth = depth;
+    return node;
+}
+
+static lnode_t *s_analyze_let_plain(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    return s_analyze_let(exec, scope, v, 0);
+}
+
+static lnode_t *s_analyze_let_star(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    return s_analyze_let(exec, scope, v, 1);
+}
+
+static lnode_t *s_analyze_set(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+
+    rt_assert(s_arg_count(exec, v) == 2, le_arity, "set! arity");
+    rt_assert(L_CADR(v)->type == l_sym, le_type, "cannot set! non-symbol");
+
+    node = s_node_new(ln_set, s_exec_set, v, 1);
+    node->value = L_CADR(v);
+    node->body = s_analyze_symbol(exec, scope, L_CADR(v));
+    node->argv[0] = s_analyze(exec, scope, L_CADDR(v));
+
+    return node;
+}
+
+static int s_is_keyword(lv_t *v, char *name) {
+    return v->type == l_sym && !strcmp(L_SYM(v), name);
+}
+
+/**
+ * analyze cond clauses into a chain of if nodes, with an or for
+ * a clause that is only a test
+ */
+static lnode_t *s_analyze_clauses(lexec_t *exec, lscope_t *scope,
+                                  lv_t *v, lv_t *clauses) {
+    lnode_t *node, *let;
+    lv_t *clause, *value;
+
+    if(!clauses)
+        return s_analyze_const(v, lisp_create_null());
+
+    clause = L_CAR(clauses);
+    rt_assert(clause->type == l_pair, le_syntax, "bad cond clause");
+
+    if(s_is_keyword(L_CAR(clause), "else"))
+        return s_analyze_body(exec, scope, clause, L_CDR(clause));
+
+    if(!L_CDR(clause)) {
+        node = s_node_new(ln_or, s_exec_or, clause, 2);
+        node->argv[0] = s_analyze(exec, scope, L_CAR(clause));
+        node->argv[1] = s_analyze_clauses(exec, scope, v, L_CDR(clauses));
+        return node;
+    }
+
+    if(s_is_keyword(L_CADR(clause), "=>")) {
+        rt_assert(c_list_length(clause) == 3, le_arity, "cond => arity");
+
+        /* bind the test to a name no program can spell, and
+         * run the rest of the clauses in its scope */
+        value = lisp_create_symbol("=> value");
+
+        let = s_node_new(ln_let, s_exec_let, clause, 1);
+        let->scope = s_scope_new(NULL, scope);
+        s_scope_add(let->scope, value);
+        let->argv[0] = s_analyze(exec, scope, L_CAR(clause));
+
+        node = s_node_new(ln_if, s_exec_if, clause, 3);
+        node->argv[0] = s_analyze(exec, let->scope, value);
+        node->argv[1] = s_analyze(exec, let->scope,
+                                  c_make_list(L_CADDR(clause), value, NULL));
+        node->argv[2] = s_analyze_clauses(exec, let->scope, v, L_CDR(clauses));
+        let->body = node;
+
+        return let;
+    }
+
+    node = s_node_new(ln_if, s_exec_if, clause, 3);
+    node->argv[0] = s_analyze(exec, scope, L_CAR(clause));
+    node->argv[1] = s_analyze_body(exec, scope, clause, L_CDR(clause));
+    node->argv[2] = s_analyze_clauses(exec, scope, v, L_CDR(clauses));
+
+    return node;
+}
+
+static lnode_t *s_analyze_cond(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    s_arg_count(exec, v);  /* checks the form is a proper list */
+    return s_analyze_clauses(exec, scope, v, L_CDR(v));
+}
+
+static lnode_t *s_analyze_logical(lexec_t *exec, lscope_t *scope, lv_t *v,
+                                  int is_and) {
+    lnode_t *node;
+    lv_t *vptr;
+    int index = 0;
+
+    /* (and) is #t, (or) is #f */
+    if(!s_arg_count(exec, v))
+        return s_analyze_const(v, lisp_create_bool(is_and));
+
+    node = s_node_new(is_and ? ln_and : ln_or,
+                      is_and ? s_exec_and : s_exec_or,
+                      v, s_arg_count(exec, v));
+
+    for(vptr = L_CDR(v); vptr; vptr = L_CDR(vptr))
+        node->argv[index++] = s_analyze(exec, scope, L_CAR(vptr));
+
+    return node;
+}
+
+static lnode_t *s_analyze_and(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    return s_analyze_logical(exec, scope, v, 1);
+}
+
+static lnode_t *s_analyze_or(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    return s_analyze_logical(exec, scope, v, 0);
+}
+
+static lnode_t *s_analyze_case(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+    lv_t *clause, *vptr;
+    lv_t *data = NULL;
+    lv_t *dptr = NULL;
+    int index = 1;
+
+    rt_assert(s_arg_count(exec, v) >= 1, le_arity, "case arity");
+
+    node = s_node_new(ln_case, s_exec_case, v, s_arg_count(exec, v));
+    node->argv[0] = s_analyze(exec, scope, L_CADR(v));
+
+    /* the data of each clause, or else, go in node->value */
+    for(vptr = L_CDDR(v); vptr; vptr = L_CDR(vptr)) {
+        clause = L_CAR(vptr);
+        rt_assert(clause->type == l_pair && L_CDR(clause), le_syntax,
+                  "bad case clause");
+        rt_assert(s_is_keyword(L_CAR(clause), "else") ||
+                  L_CAR(clause)->type == l_pair ||
+                  L_CAR(clause)->type == l_null, le_syntax,
+                  "bad case clause");
+
+        if(dptr) {
+            L_CDR(dptr) = lisp_create_pair(L_CAR(clause), NULL);
+            dptr = L_CDR(dptr);
+        } else {
+            data = dptr = lisp_create_pair(L_CAR(clause), NULL);
+        }
+
+        node->argv[index++] = s_analyze_body(exec, scope, clause,
+                                             L_CDR(clause));
+    }
+
+    node->value = data;
+    return node;
+}
+
+static lnode_t *s_analyze_do(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lnode_t *node;
+    lv_t *specs, *spec, *finish;
+    int count = 0;
+    int index;
+
+    rt_assert(s_arg_count(exec, v) >= 2, le_arity, "do arity");
+
+    specs = L_CADR(v);
+    finish = L_CADDR(v);
+    rt_assert(specs->type == l_pair || specs->type == l_null, le_syntax,
+              "bad do bindings");
+    rt_assert(finish->type == l_pair, le_syntax, "bad do exit clause");
+
+    node = s_node_new(ln_do, s_exec_do, v, 0);
+    node->scope = s_scope_new(NULL, scope);
+
+    for(; specs && specs->type == l_pair; specs = L_CDR(specs)) {
+        spec = L_CAR(specs);
+        rt_assert(spec->type == l_pair && L_CAR(spec)->type == l_sym &&
+                  L_CDR(spec) && (c_list_length(spec) == 2 ||
+                                  c_list_length(spec) == 3),
+                  le_syntax, "bad do binding");
+
+        s_scope_add(node->scope, L_CAR(spec));
+        count++;
+    }
+
+    node->scope->form = v;
+    node->scope->fixed = count;
+
+    node->argc = 2 * count + 3;
+    node->argv = safe_malloc(sizeof(lnode_t *) * node->argc);
+
+    node->argv[0] = s_analyze(exec, node->scope, L_CAR(finish));
+    node->argv[1] = s_analyze_body(exec, node->scope, finish, L_CDR(finish));
+    node->argv[2] = s_analyze_body(exec, node->scope, v, L_CDR(L_CDDR(v)));
+
+    /* inits run outside the loop, steps inside it.  A variable
+     * with no step keeps its value. */
+    for(index = 0, specs = L_CADR(v); index < count;
+        index++, specs = L_CDR(specs)) {
+        spec = L_CAR(specs);
+        node->argv[3 + index] = s_analyze(exec, scope, L_CADR(spec));
+        node->argv[3 + count + index] =
+            s_analyze(exec, node->scope,
+                      L_CDDR(spec) ? L_CADDR(spec) : L_CAR(spec));
+    }
+
+    return node;
+}
+
+typedef lnode_t *(*lform_fn_t)(lexec_t *, lscope_t *, lv_t *);
+
+/* analyzers for the special forms, by symbol tag */
+static lform_fn_t s_forms[lsf_max] = {
+    [lsf_quote] = s_analyze_quote,
+    [lsf_define] = s_analyze_define,
+    [lsf_lambda] = s_analyze_lambda,
+    [lsf_defmacro] = s_analyze_defmacro,
+    [lsf_begin] = s_analyze_begin,
+    [lsf_quasiquote] = s_analyze_quasiquote,
+    [lsf_if] = s_analyze_if,
+    [lsf_let] = s_analyze_let_plain,
+    [lsf_let_star] = s_analyze_let_star,
+    [lsf_set] = s_analyze_set,
+    [lsf_cond] = s_analyze_cond,
+    [lsf_and] = s_analyze_and,
+    [lsf_or] = s_analyze_or,
+    [lsf_case] = s_analyze_case,
+    [lsf_do] = s_analyze_do,
+};
+
+/**
+ * the special form a symbol name stands for, or lsf_none.  Run
+ * once when a symbol is made.
+ */
+int lisp_form_tag(char *name) {
+    int tag;
+
+    for(tag = lsf_none + 1; tag < lsf_max; tag++)
+        if(name[0] == s_form_names[tag][0] && !strcmp(name, s_form_names[tag]))
+            return tag;
+
+    return lsf_none;
+}
+
+/**
+ * analyze a form in a static scope
+ */
+static lnode_t *s_analyze(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    if(v->type == l_sym)
+        return s_analyze_symbol(exec, scope, v);
+
+    if(v->type != l_pair)  // atom?
+        return s_analyze_const(v, v);
+
+    /* special forms are tagged on their symbol */
+    if(L_CAR(v)->type == l_sym && L_SYM_FORM(L_CAR(v)))
+        return s_forms[L_SYM_FORM(L_CAR(v))](exec, scope, v);
+
+    /* otherwise, it's a function application */
+    return s_analyze_apply(exec, scope, v);
+}
+
+/*
+ * load-time macro expansion
+ */
+
+static lv_t *s_expand(lexec_t *exec, lscope_t *scope, lv_t *v);
+
+/**
+ * rebuild a pair only if its parts changed, keeping the source
+ * position of the original
+ */
+static lv_t *s_expand_pair(lv_t *v, lv_t *car, lv_t *cdr) {
+    lv_t *result;
+    int row, col;
+    char *file;
+
+    if(car == L_CAR(v) && cdr == L_CDR(v))
+        return v;
+
+    result = lisp_create_pair(car, cdr);
+    if(lisp_value_pos(v, &row, &col, &file))
+        lisp_stamp_value(result, row, col, file);
+    return result;
+}
+
+/**
+ * expand every form of a list of forms
+ */
+static lv_t *s_expand_list(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    if(!v || v->type != l_pair)
+        return v;
+
+    return s_expand_pair(v, s_expand(exec, scope, L_CAR(v)),
+                         s_expand_list(exec, scope, L_CDR(v)));
+}
+
+/**
+ * expand the forms of a list after the first skip items
+ */
+static lv_t *s_expand_tail(lexec_t *exec, lscope_t *scope, lv_t *v, int skip) {
+    if(!skip)
+        return s_expand_list(exec, scope, v);
+
+    if(!v || v->type != l_pair)
+        return v;
+
+    return s_expand_pair(v, L_CAR(v),
+                         s_expand_tail(exec, scope, L_CDR(v), skip - 1));
+}
+
+/**
+ * expand only the unquoted parts of a quasiquote template
+ */
+static lv_t *s_expand_template(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    if(v->type != l_pair)
+        return v;
+
+    if(s_is_tagged(v, "unquote") || s_is_tagged(v, "unquote-splicing"))
+        return s_expand_tail(exec, scope, v, 1);
+
+    return s_expand_pair(v, s_expand_template(exec, scope, L_CAR(v)),
+                         L_CDR(v) ? s_expand_template(exec, scope, L_CDR(v))
+                         : NULL);
+}
+
+/**
+ * expand the bindings of a let, let* or do, whose names are
+ * bound in inner.  Inits run in outer (inner for let*), and do
+ * steps in inner.
+ */
+static lv_t *s_expand_bindings(lexec_t *exec, lscope_t *outer,
+                               lscope_t *inner, lv_t *v) {
+    lv_t *binding;
+
+    if(!v || v->type != l_pair)
+        return v;
+
+    binding = L_CAR(v);
+    if(binding->type == l_pair && L_CDR(binding) &&
+       L_CDR(binding)->type == l_pair) {
+        binding = s_expand_pair(binding, L_CAR(binding),
+                                s_expand_pair(L_CDR(binding),
+                                              s_expand(exec, outer,
+                                                       L_CADR(binding)),
+                                              s_expand_list(exec, inner,
+                                                            L_CDDR(binding))));
+    }
+
+    return s_expand_pair(v, binding,
+                         s_expand_bindings(exec, outer, inner, L_CDR(v)));
+}
+
+/**
+ * expand the forms of each clause of a cond or case, after the
+ * first skip items of the clause
+ */
+static lv_t *s_expand_clauses(lexec_t *exec, lscope_t *scope,
+                              lv_t *v, int skip) {
+    if(!v || v->type != l_pair)
+        return v;
+
+    return s_expand_pair(v, s_expand_tail(exec, scope, L_CAR(v), skip),
+                         s_expand_clauses(exec, scope, L_CDR(v), skip));
+}
+
+/**
+ * open a scope for the names of a list of bindings
+ */
+static lscope_t *s_expand_scope(lv_t *bindings, lscope_t *next) {
+    lscope_t *scope = s_scope_new(NULL, next);
+
+    for(; bindings && bindings->type == l_pair; bindings = L_CDR(bindings))
+        if(L_CAR(bindings)->type == l_pair)
+            s_scope_add(scope, L_CAAR(bindings));
+
+    return scope;
+}
+
+static int s_is_local(lscope_t *scope, lv_t *sym) {
+    for(; scope; scope = scope->next)
+        if(s_scope_slot(scope, sym) != -1)
+            return 1;
+
+    return 0;
+}
+
+/**
+ * expand the macro uses in a form.  Only names that are not
+ * bound lexically and are globally bound to a macro at the time
+ * are expanded.  Anything missed here (dynamic macros, or macros
+ * defined later) is still expanded when it runs.
+ */
+static lv_t *s_expand(lexec_t *exec, lscope_t *scope, lv_t *v) {
+    lv_t *op, *macro, *args, *body;
+    lscope_t *inner;
+
+    while(1) {
+        if(v->type != l_pair)
+            return v;
+
+        op = L_CAR(v);
+        if(op->type != l_sym || s_is_local(scope, op))
+            return s_expand_list(exec, scope, v);
+
+        switch(L_SYM_FORM(op)) {
+        case lsf_quote:
+            return v;
+        case lsf_quasiquote:
+            return s_expand_pair(v, op, s_expand_template(exec, scope,
+                                                          L_CDR(v)));
+        case lsf_lambda:
+            if(!L_CDR(v))
+                return v;
+            inner = s_scope_new(L_CADR(v), scope);
+            if(L_CDDR(v) && L_CDDR(v)->type == l_pair)
+                s_scope_defines(inner, L_CADDR(v));
+            return s_expand_tail(exec, inner, v, 2);
+        case lsf_defmacro:
+            if(!L_CDR(v) || !L_CDDR(v))
+                return v;
+            return s_expand_tail(exec, s_scope_new(L_CADDR(v), scope), v, 3);
+        case lsf_define:
+            if(scope && L_CDR(v) && L_CADR(v)->type == l_sym &&
+               s_scope_slot(scope, L_CADR(v)) == -1)
+                s_scope_add(scope, L_CADR(v));
+            return s_expand_tail(exec, scope, v, 2);
+        case lsf_let:
+        case lsf_let_star:
+        case lsf_do:
+            if(!L_CDR(v))
+                return v;
+
+            inner = s_expand_scope(L_CADR(v), scope);
+            args = s_expand_bindings(exec,
+                                     L_SYM_FORM(op) == lsf_let_star ?
+                                     inner : scope, inner, L_CADR(v));
+
+            /* the exit clause of a do is a list of forms */
+            body = L_CDDR(v);
+            if(L_SYM_FORM(op) != lsf_do && body && body->type == l_pair)
+                s_scope_defines(inner, L_CAR(body));
+
+            if(L_SYM_FORM(op) == lsf_do && body)
+                body = s_expand_pair(body,
+                                     s_expand_list(exec, inner, L_CAR(body)),
+                                     s_expand_list(exec, inner, L_CDR(body)));
+            else
+                body = s_expand_list(exec, inner, body);
+
+            return s_expand_pair(v, op, s_expand_pair(L_CDR(v), args, body));
+        case lsf_cond:
+            return s_expand_pair(v, op, s_expand_clauses(exec, scope,
+                                                         L_CDR(v), 0));
+        case lsf_case:
+            if(!L_CDR(v))
+                return v;
+            return s_expand_pair(v, op, s_expand_pair(
+                                     L_CDR(v), s_expand(exec, scope, L_CADR(v)),
+                                     s_expand_clauses(exec, scope,
+                                                      L_CDDR(v), 1)));
+        case lsf_none:
+            break;
+        default:
+            /* the rest evaluate all their arguments */
+            return s_expand_tail(exec, scope, v, 1);
+        }
+
+        macro = c_env_lookup(exec->env, op);
+        if(!macro || macro->type != l_fn ||
+           L_FN_FTYPE(macro) != lf_macro || L_FN_DYNAMIC(macro))
+            return s_expand_list(exec, scope, v);
+
+        args = L_CDR(v);
+        if(!args)
+            args = lisp_create_null();
+
+        v = lisp_macro_expand(exec, macro, args);
+    }
+}
+
+/**
+ * expand the macro uses of a top-level form before it runs, so
+ * that it reaches the analyzer (mostly) as core forms
+ */
+lv_t *lisp_expand(lexec_t *exec, lv_t *v) {
+    assert(exec && v);
+
+    return s_expand(exec, NULL, v);
+}
+
+/**
+ * analyze a form, resolving the special forms once so that
+ * executing the result never has to look at syntax again
+ */
+lnode_t *lisp_analyze(lexec_t *exec, lv_t *v) {
+    assert(exec && v);
+
+    return s_analyze(exec, s_root_scope(exec->env), v);
+}
+
+/**
+ * expand the macro call at an apply node, analyzing the
+ * expansion in the scope of the call.  The expansion is kept on
+ * the node and reused while the operator is the same macro,
+ * unless the macro is marked dynamic.
+ */
+lnode_t *lisp_expand_node(lexec_t *exec, lnode_t *node, lv_t *macro) {
+    lnode_t *expansion;
+    lv_t *args;
+
+    assert(exec && node && node->type == ln_apply);
+
+    if(node->expansion && node->ic_macro == macro)
+        return node->expansion;
+
+    args = L_CDR(node->form);
+    if(!args)
+        args = lisp_create_null();
+
+    expansion = s_analyze(exec, node->scope,
+                          lisp_macro_expand(exec, macro, args));
+
+    if(!L_FN_DYNAMIC(macro)) {
+        node->ic_macro = macro;
+        node->expansion = expansion;
+    }
+
+    return expansion;
+}
+
+/**
+ * run an analyzed node in the current environment.  Handlers
+ * hand back their tail position as a tail request rather than
+ * recursing, and this loop runs it, so the C stack does not grow
+ * with tail calls.  Whatever env the handlers switched to is
+ * dropped on the way out, along with the region frames of the
+ * calls it entered.
+ */
+lv_t *lisp_exec_node(lexec_t *exec, lnode_t *node) {
+    lv_t *env, *result;
+    lstack_t *env_stack, *eval_stack;
+    lregion_t region;
+
+    assert(exec && node);
+
+    env = exec->env;
+    env_stack = exec->env_stack;
+    eval_stack = exec->eval_stack;
+    region = exec->region;
+
+    while((result = node->fn(exec, node)) == LISP_TAIL)
+        node = lisp_tail_enter(exec, env_stack, eval_stack, &region);
+
+    exec->env = env;
+    exec->env_stack = env_stack;
+    exec->eval_stack = eval_stack;
+    lisp_region_release(exec, &region);
+
+    return result;
+}
+
+/**
+ * assemble a quasiquote template from the values of its
+ * sub-nodes (and dotted tail, if any), splicing where the
+ * template asks for it
+ */
+lv_t *lisp_quasi_build(lexec_t *exec, lnode_t *node, lv_t **values) {
+    lv_t *result = NULL;
+    lv_t *rptr = NULL;
+    lv_t *item, *vptr;
+    int index;
+
+    assert(exec && node && node->type == ln_quasiquote);
+
+    for(index = 0; index < node->argc; index++) {
+        vptr = values[index];
+        if(node->argv[index]->type == ln_splice) {
+            rt_assert(vptr->type == l_pair || vptr->type == l_null, le_type,
+                      "unquote-splicing expects list");
+
+            if(vptr->type == l_null)
+                continue;
+        } else {
+            vptr = lisp_create_pair(vptr, NULL);
+        }
+
+        while(vptr && vptr->type == l_pair) {
+            item = lisp_create_pair(L_CAR(vptr), NULL);
+            if(rptr)
+                L_CDR(rptr) = item;
+            else
+                result = item;
+            rptr = item;
+            vptr = L_CDR(vptr);
+        }
+    }
+
+    if(node->body) {
+        item = values[node->argc];
+        if(!rptr)
+            return item;
+        if(item->type != l_null)
+            L_CDR(rptr) = item;
+    }
+
+    if(!result)
+        return lisp_create_null();
+
+    return result;
+}
+
+/**
+ * get the analyzed body of a lambda or macro, analyzing
+ * it on first use if it was built outside the analyzer
+ */
+lnode_t *lisp_fn_code(lexec_t *exec, lv_t *fn) {
+    assert(exec && fn && fn->type == l_fn);
+    assert(L_FN_FTYPE(fn) != lf_native);
+
+    if(!L_FN_CODE(fn)) {
+        L_FN_SCOPE(fn) = s_scope_new(L_FN_ARGS(fn),
+                                     s_root_scope(L_FN_ENV(fn)));
+        L_FN_SCOPE(fn)->form = L_FN_BODY(fn);
+        L_FN_CODE(fn) = s_analyze(exec, L_FN_SCOPE(fn), L_FN_BODY(fn));
+    }
+
+    return L_FN_CODE(fn);
+}
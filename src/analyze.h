@@ -0,0 +1,141 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _ANALYZE_H_
+#define _ANALYZE_H_
+
+#define LISP_NODES \
+    C(ln_const) \
+    C(ln_ref) \
+    C(ln_local) \
+    C(ln_global) \
+    C(ln_define) \
+    C(ln_lambda) \
+    C(ln_defmacro) \
+    C(ln_begin) \
+    C(ln_quasiquote) \
+    C(ln_splice) \
+    C(ln_if) \
+    C(ln_let) \
+    C(ln_let_star) \
+    C(ln_set) \
+    C(ln_and) \
+    C(ln_or) \
+    C(ln_case) \
+    C(ln_do) \
+    C(ln_apply) \
+    C(ln_fold)
+
+#define C(x) x,
+typedef enum lisp_node_t { LISP_NODES ln_max } lisp_node_t;
+#undef C
+
+extern char *lisp_nodes_list[];
+
+/* special forms.  Symbols are tagged with their form when they
+ * are made, so the analyzer dispatches on the tag. */
+#define LISP_FORMS \
+    F(lsf_none, "") \
+    F(lsf_quote, "quote") \
+    F(lsf_define, "define") \
+    F(lsf_lambda, "lambda") \
+    F(lsf_defmacro, "defmacro") \
+    F(lsf_begin, "begin") \
+    F(lsf_quasiquote, "quasiquote") \
+    F(lsf_if, "if") \
+    F(lsf_let, "let") \
+    F(lsf_let_star, "let*") \
+    F(lsf_set, "set!") \
+    F(lsf_cond, "cond") \
+    F(lsf_and, "and") \
+    F(lsf_or, "or") \
+    F(lsf_case, "case") \
+    F(lsf_do, "do")
+
+#define F(x, name) x,
+typedef enum lisp_form_t { LISP_FORMS lsf_max } lisp_form_t;
+#undef F
+
+typedef lv_t *(*lnode_fn_t)(lexec_t *, lnode_t *);
+
+/**
+ * one frame of the static scope, matching an env layer
+ * made at runtime by a lambda call or a let
+ */
+struct lscope_t {
+    lv_t *names;              // bound symbols, in slot order
+    int count;
+    int fixed;                // leading slots bound on entry, before
+                              // any let* init or internal define
+    int hide;                 // slots hide..hide_end-1 are let*
+    int hide_end;             // bindings not made yet while the inits
+                              // are analyzed, found only as a last resort
+    lv_t *form;               // the form that binds them
+    int transient;            // frames never outlive the call, and
+                              // can come from the region
+    lscope_t *next;           // enclosing frame
+};
+
+/**
+ * a pre-analyzed expression.  Syntax is resolved once, when the
+ * form is analyzed, and the node handler (fn) does only the
+ * runtime work for that form.
+ */
+struct lnode_t {
+    lisp_node_t type;
+    lnode_fn_t fn;
+    lv_t *form;        // source form
+    lv_t *value;       // constant, symbol, or formals
+    lnode_t *body;     // lambda/let body, or the operator of an apply
+    int argc;
+    lnode_t **argv;    // arguments, branches, sequence, let inits,
+                       // or the variables a flat closure copies
+    int depth;         // frame depth of a local, or of the globals,
+                       // or the frames a flat closure leaves out
+    int slot;          // slot of a local in its frame
+    lscope_t *scope;   // frame opened by a lambda or let, or the
+                       // scope an apply was analyzed in
+    lv_t **cell;       // binding of a global, linked on first use
+    lv_t *ic_value;    // lookup cache: value found by name,
+    lv_t *ic_env;      // the env it was looked up from,
+    unsigned int ic_version;  // and lisp_env_version at the time
+    lv_t *ic_macro;    // macro the expansion of this call was made by,
+    lnode_t *expansion;  // and the analyzed expansion
+    lv_t *fold_fn;     // primitive a fold was made with
+    lcode_t *code;     // compiled form of this node, for the vm
+    lmath_site_t *site;  // type feedback of a call, see math_site_op
+};
+
+extern lnode_t *lisp_analyze(lexec_t *exec, lv_t *v);
+extern lv_t *lisp_expand(lexec_t *exec, lv_t *v);
+extern lv_t *lisp_exec_node(lexec_t *exec, lnode_t *node);
+extern lnode_t *lisp_fn_code(lexec_t *exec, lv_t *fn);
+extern lnode_t *lisp_expand_node(lexec_t *exec, lnode_t *node, lv_t *macro);
+extern lv_t *lisp_local_lookup(lexec_t *exec, lnode_t *node);
+extern lv_t *lisp_global_lookup(lexec_t *exec, lnode_t *node);
+extern lv_t *lisp_static_global(lexec_t *exec, lnode_t *node);
+extern lv_t *lisp_dynamic_lookup(lexec_t *exec, lnode_t *node);
+extern lv_t *lisp_quasi_build(lexec_t *exec, lnode_t *node, lv_t **values);
+extern lv_t *lisp_set_node(lexec_t *exec, lnode_t *node, lv_t *value);
+extern int lisp_case_select(lexec_t *exec, lnode_t *node, lv_t *key);
+extern int lisp_fold_valid(lexec_t *exec, lnode_t *node);
+extern int lisp_form_tag(char *name);
+
+#endif /* _ANALYZE_H_ */
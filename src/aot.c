@@ -0,0 +1,1245 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * ahead of time compilation of a program to C.  Each top level
+ * form is expanded and analyzed as it would be when loaded, and
+ * the analyzed tree is written out as C functions over the
+ * library.  Lambdas become argument vector natives with their
+ * variables in C locals, and calls between them go direct.
+ *
+ * Only code that never needs its variables in an env is
+ * compiled: a lambda may not use the variables of an enclosing
+ * lambda, define internally, or call a macro.  A top level form
+ * with anything of that kind in it is kept as data instead, and
+ * handed to the interpreter when the program runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <setjmp.h>
+
+#include "lisp-types.h"
+#include "primitives.h"
+#include "builtins.h"
+#include "analyze.h"
+#include "aot.h"
+
+/**
+ * a top level define of a lambda.  These are found before any
+ * form is compiled, so code compiled ahead of the define can
+ * still call the lambda directly.
+ */
+typedef struct aot_known_t {
+    lv_t *sym;
+    int form;           // top level form doing the define
+    int fn;             // function number reserved for the lambda
+    int min_args;
+    int max_args;
+} aot_known_t;
+
+/**
+ * a lisp variable living in C variable v<var>
+ */
+typedef struct aot_var_t {
+    lv_t *sym;
+    int var;
+    int used;           // read somewhere in its scope
+    struct aot_var_t *next;
+} aot_var_t;
+
+/**
+ * a growable output buffer
+ */
+typedef struct aot_buf_t {
+    FILE *f;
+    char *data;
+    size_t size;
+} aot_buf_t;
+
+/**
+ * the C function being written
+ */
+typedef struct aot_fn_t {
+    aot_buf_t body;
+    int indent;
+    aot_var_t *vars;    // variables in scope, innermost first
+    int fn;             // function number
+    int *params;        // variables of the formals
+    int nparams;
+    int rest;           // formals take a rest list
+    int self_used;      // a self tail call jumps to the top
+    int toplevel;       // running at top level, where define is global
+} aot_fn_t;
+
+typedef struct aot_t {
+    lexec_t *exec;
+    aot_fn_t *cur;
+    int fail;           // form can't be compiled
+
+    aot_known_t *known;
+    int nknown;
+    lv_t *macros;       // names defmacro'd at top level
+    int reserve;        // function reserved for the form being compiled
+
+    /* counters for the tables of the generated program */
+    int nconsts;
+    int nfns;
+    int nglobals;
+    lv_t *globals;      // names of s_g, last first
+    int next_var;
+
+    /* code and init statements of the form being compiled, and
+     * of all the forms done so far */
+    aot_buf_t *code;
+    aot_buf_t *init;
+    aot_buf_t all_code;
+    aot_buf_t all_init;
+    aot_buf_t all_main;
+} aot_t;
+
+/* support code for the generated program */
+static char *s_preamble =
+    "#define S_FALSE(v) ((v) == LISP_FALSE)\n"
+    "\n"
+    "typedef lv_t *(*s_code_t)(lexec_t *, int, lv_t **);\n"
+    "\n"
+    "/* a global, by its cell in the innermost global layer, or\n"
+    " * by the value last found further out */\n"
+    "typedef struct s_global_t {\n"
+    "    lv_t *sym;\n"
+    "    lv_t **cell;\n"
+    "    lv_t *value;\n"
+    "    unsigned int version;\n"
+    "} s_global_t;\n"
+    "\n"
+    "static lv_t *s_env;\n"
+    "static lv_t *s_tc_fn;\n"
+    "static s_code_t s_tc_code;\n"
+    "static int s_tc_argc;\n"
+    "static lv_t **s_tc_argv;\n"
+    "static lexec_t *s_test_exec;\n"
+    "static int s_test_failed;\n"
+    "\n"
+    "static lv_t *s_global(lexec_t *exec, s_global_t *g) {\n"
+    "    lv_t *result;\n"
+    "\n"
+    "    if(*g->cell || (g->value && g->version == lisp_env_version)) {\n"
+    "        exec->ic_hits++;\n"
+    "        return *g->cell ? *g->cell : g->value;\n"
+    "    }\n"
+    "\n"
+    "    exec->ic_misses++;\n"
+    "\n"
+    "    /* unbound symbols evaluate to themselves */\n"
+    "    if(!L_CDR(s_env) || !(result = c_env_lookup(L_CDR(s_env), g->sym)))\n"
+    "        return g->sym;\n"
+    "\n"
+    "    g->value = result;\n"
+    "    g->version = lisp_env_version;\n"
+    "    return result;\n"
+    "}\n"
+    "\n"
+    "static inline lv_t *s_set(lexec_t *exec, s_global_t *g, lv_t *value) {\n"
+    "    lv_t *env = exec->env;\n"
+    "\n"
+    "    if(*g->cell) {\n"
+    "        *g->cell = value;\n"
+    "        lisp_env_version++;\n"
+    "        return lisp_create_null();\n"
+    "    }\n"
+    "\n"
+    "    exec->env = s_env;\n"
+    "    lisp_set(exec, g->sym, value);\n"
+    "    exec->env = env;\n"
+    "    return lisp_create_null();\n"
+    "}\n"
+    "\n"
+    "/* tail calls between compiled functions return to s_run */\n"
+    "static inline lv_t *s_tail(lv_t *fn, s_code_t code, int argc, lv_t **argv) {\n"
+    "    s_tc_argv = safe_malloc(sizeof(lv_t *) * (argc + 1));\n"
+    "    memcpy(s_tc_argv, argv, sizeof(lv_t *) * argc);\n"
+    "    s_tc_argc = argc;\n"
+    "    s_tc_fn = fn;\n"
+    "    s_tc_code = code;\n"
+    "    return LISP_TAIL;\n"
+    "}\n"
+    "\n"
+    "/* the function running is on top of the eval stack, and each\n"
+    " * tail call replaces it there */\n"
+    "static lv_t *s_run(lexec_t *exec, s_code_t code, int argc, lv_t **argv) {\n"
+    "    lstack_t *eval_stack = exec->eval_stack;\n"
+    "    lv_t *result;\n"
+    "\n"
+    "    while((result = code(exec, argc, argv)) == LISP_TAIL) {\n"
+    "        exec->eval_stack = eval_stack->next;\n"
+    "        lisp_exec_push_eval(exec, s_tc_fn);\n"
+    "        code = s_tc_code;\n"
+    "        argc = s_tc_argc;\n"
+    "        argv = s_tc_argv;\n"
+    "    }\n"
+    "\n"
+    "    exec->eval_stack = eval_stack;\n"
+    "    return result;\n"
+    "}\n"
+    "\n"
+    "static int s_eval(lexec_t *exec, lv_t *form) {\n"
+    "    lisp_execute(exec, lisp_create_pair(form, NULL));\n"
+    "    return exec->exc == le_success;\n"
+    "}\n"
+    "\n"
+    "static void s_test(lv_t *key, lv_t *value) {\n"
+    "    char buffer[256];\n"
+    "    char *name = key->type == l_sym ? L_SYM(key) : L_STR(key);\n"
+    "    char *result = \"Ok\";\n"
+    "\n"
+    "    if(strlen(name) <= 4 || strncasecmp(name, \"test\", 4))\n"
+    "        return;\n"
+    "\n"
+    "    snprintf(buffer, sizeof(buffer), \"(%s)\", name);\n"
+    "    lisp_execute(s_test_exec, c_parse_string(s_test_exec, buffer));\n"
+    "\n"
+    "    if(s_test_exec->exc == le_warn) {\n"
+    "        result = \"WARN\";\n"
+    "    } else if(s_test_exec->exc) {\n"
+    "        result = \"FAIL\";\n"
+    "        s_test_failed = 1;\n"
+    "    }\n"
+    "\n"
+    "    printf(\"%s%*s: %s\\n\", name, (int)(strlen(name) < 40 ?\n"
+    "                                     40 - strlen(name) : 1), \" \", result);\n"
+    "}\n"
+    "\n";
+
+static void s_emit(aot_t *aot, lnode_t *node, char *target);
+
+/*
+ * output
+ */
+
+static void s_buf_open(aot_buf_t *buf) {
+    buf->data = NULL;
+    buf->size = 0;
+    buf->f = open_memstream(&buf->data, &buf->size);
+    assert(buf->f);
+}
+
+/**
+ * finish a buffer, appending what was written to it to dst, if
+ * there is one, or dropping it
+ */
+static void s_buf_close(aot_buf_t *buf, aot_buf_t *dst) {
+    fclose(buf->f);
+    if(dst)
+        fwrite(buf->data, 1, buf->size, dst->f);
+    free(buf->data);
+}
+
+static void s_line(aot_t *aot, char *fmt, ...) {
+    va_list args;
+
+    fprintf(aot->cur->body.f, "%*s", aot->cur->indent * 4, "");
+    va_start(args, fmt);
+    vfprintf(aot->cur->body.f, fmt, args);
+    va_end(args);
+    fputc('\n', aot->cur->body.f);
+}
+
+/* target for a value that is thrown away */
+static char s_discard[] = "";
+
+/**
+ * deliver the value of C expression fmt to target, or return it
+ * if target is NULL (the tail position)
+ */
+static void s_put(aot_t *aot, char *target, char *fmt, ...) {
+    va_list args;
+    char *expr;
+
+    va_start(args, fmt);
+    if(vasprintf(&expr, fmt, args) < 0) {
+        perror("vasprintf");
+        exit(EXIT_FAILURE);
+    }
+    va_end(args);
+
+    if(target == s_discard)
+        s_line(aot, "(void)%s;", expr);
+    else if(target)
+        s_line(aot, "%s = %s;", target, expr);
+    else
+        s_line(aot, "return %s;", expr);
+
+    free(expr);
+}
+
+static void s_open(aot_t *aot, char *fmt, ...) {
+    va_list args;
+
+    fprintf(aot->cur->body.f, "%*s", aot->cur->indent * 4, "");
+    va_start(args, fmt);
+    vfprintf(aot->cur->body.f, fmt, args);
+    va_end(args);
+    fputs(*fmt ? " {\n" : "{\n", aot->cur->body.f);
+    aot->cur->indent++;
+}
+
+static void s_close(aot_t *aot) {
+    aot->cur->indent--;
+    s_line(aot, "}");
+}
+
+static int s_temp(aot_t *aot, char *buf, size_t len) {
+    int var = aot->next_var++;
+
+    snprintf(buf, len, "t%d", var);
+    return var;
+}
+
+static void s_cstring(FILE *f, char *str) {
+    fputc('"', f);
+    for(; *str; str++) {
+        if(*str == '"' || *str == '\\')
+            fprintf(f, "\\%c", *str);
+        else if(*str == '\n')
+            fputs("\\n", f);
+        else if(*str == '\t')
+            fputs("\\t", f);
+        else if(*str < ' ' || *str > '~')
+            fprintf(f, "\\%03o", (unsigned char)*str);
+        else
+            fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+/**
+ * write a C expression that builds value v, returning 0 if v is
+ * not a kind of value that can be built from C
+ */
+static int s_value(FILE *f, lv_t *v) {
+    char *str;
+
+    if(!v) {
+        fputs("NULL", f);
+        return 1;
+    }
+
+    switch(v->type) {
+    case l_int:
+        if(!L_INT_BIG(v)) {
+            fprintf(f, "lisp_create_int_str(\"%" PRId64 "\")", L_FIX(v));
+            return 1;
+        }
+        str = mpz_get_str(NULL, 10, L_INT(v));
+        fprintf(f, "lisp_create_int_str(\"%s\")", str);
+        return 1;
+    case l_rational:
+        str = mpq_get_str(NULL, 10, L_RAT(v));
+        fprintf(f, "lisp_create_rational_str(\"%s\")", str);
+        return 1;
+    case l_float:
+        /* enough digits to read back the same value */
+        fprintf(f, "lisp_create_float_str(\"%.17g\")", L_FLOAT(v));
+        return 1;
+    case l_bool:
+        fprintf(f, "lisp_create_bool(%d)", L_BOOL(v));
+        return 1;
+    case l_char:
+        fprintf(f, "lisp_create_char(%d)", L_CHAR(v));
+        return 1;
+    case l_null:
+        fputs("lisp_create_null()", f);
+        return 1;
+    case l_sym:
+        fputs("lisp_create_symbol(", f);
+        s_cstring(f, L_SYM(v));
+        fputc(')', f);
+        return 1;
+    case l_str:
+        fputs("lisp_create_string(", f);
+        s_cstring(f, L_STR(v));
+        fputc(')', f);
+        return 1;
+    case l_pair:
+        fputs("lisp_create_pair(", f);
+        if(!s_value(f, L_CAR(v)))
+            return 0;
+        fputs(", ", f);
+        if(!s_value(f, L_CDR(v)))
+            return 0;
+        fputc(')', f);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * tables of the generated program
+ */
+
+/**
+ * add a constant to s_k, returning its index
+ */
+static int s_const(aot_t *aot, lv_t *v) {
+    aot_buf_t expr;
+    int ok;
+
+    s_buf_open(&expr);
+    ok = s_value(expr.f, v);
+    fclose(expr.f);
+
+    if(!ok) {
+        aot->fail = 1;
+        free(expr.data);
+        return 0;
+    }
+
+    fprintf(aot->init->f, "    s_k[%d] = %s;\n", aot->nconsts, expr.data);
+    free(expr.data);
+
+    return aot->nconsts++;
+}
+
+/**
+ * find or add the s_g entry for a global
+ */
+static int s_global(aot_t *aot, lv_t *sym) {
+    lv_t *vptr;
+    int index = aot->nglobals - 1;
+
+    for(vptr = aot->globals; vptr; vptr = L_CDR(vptr), index--)
+        if(!strcmp(L_SYM(L_CAR(vptr)), L_SYM(sym)))
+            return index;
+
+    aot->globals = lisp_create_pair(sym, aot->globals);
+
+    fprintf(aot->init->f, "    s_g[%d].sym = ", aot->nglobals);
+    s_value(aot->init->f, sym);
+    fprintf(aot->init->f, ";\n    s_g[%d].cell = c_hash_cell(L_CAR(s_env), "
+            "s_g[%d].sym);\n", aot->nglobals, aot->nglobals);
+
+    return aot->nglobals++;
+}
+
+/*
+ * variables
+ */
+
+/**
+ * bring C variable v<index> into scope as sym
+ */
+static int s_bind(aot_t *aot, lv_t *sym, int index) {
+    aot_var_t *var = safe_malloc(sizeof(aot_var_t));
+
+    var->sym = sym;
+    var->var = index;
+    var->used = 0;
+    var->next = aot->cur->vars;
+    aot->cur->vars = var;
+
+    return var->var;
+}
+
+static aot_var_t *s_lookup(aot_t *aot, lv_t *sym) {
+    aot_var_t *var;
+
+    for(var = aot->cur->vars; var; var = var->next)
+        if(!strcmp(L_SYM(var->sym), L_SYM(sym)))
+            return var;
+
+    return NULL;
+}
+
+/**
+ * the C variable holding sym, or -1 if it is not a variable of
+ * the function being compiled
+ */
+static int s_var(aot_t *aot, lv_t *sym) {
+    aot_var_t *var = s_lookup(aot, sym);
+
+    return var ? var->var : -1;
+}
+
+/**
+ * s_var, for a read of the variable
+ */
+static int s_var_read(aot_t *aot, lv_t *sym) {
+    aot_var_t *var = s_lookup(aot, sym);
+
+    if(!var)
+        return -1;
+
+    var->used = 1;
+    return var->var;
+}
+
+/**
+ * send the code of a scope to buffer code until s_declare, which
+ * is handed the stream returned
+ */
+static FILE *s_hold(aot_t *aot, aot_buf_t *code) {
+    FILE *f = aot->cur->body.f;
+
+    s_buf_open(code);
+    aot->cur->body.f = code->f;
+    return f;
+}
+
+/**
+ * write the declarations of a scope's variables, bound in vars
+ * down to stop, followed by the code of the scope.  Variables
+ * nothing reads are cast away, so the C compiler doesn't warn.
+ */
+static void s_declare(aot_t *aot, FILE *f, aot_var_t *stop, int *var,
+                      int count, aot_buf_t *code) {
+    aot_var_t *vptr;
+    int index;
+
+    aot->cur->body.f = f;
+
+    for(index = 0; index < count; index++)
+        s_line(aot, "lv_t *v%d;", var[index]);
+
+    for(vptr = aot->cur->vars; vptr != stop; vptr = vptr->next)
+        if(!vptr->used)
+            s_line(aot, "(void)v%d;", vptr->var);
+
+    s_buf_close(code, &aot->cur->body);
+}
+
+/*
+ * functions
+ */
+
+static void s_arity(lv_t *formals, int *min_args, int *max_args) {
+    *min_args = 0;
+
+    for(; formals && formals->type == l_pair; formals = L_CDR(formals))
+        (*min_args)++;
+
+    if(formals && formals->type == l_sym)
+        *max_args = LISP_ARGS_ANY;
+    else
+        *max_args = *min_args;
+}
+
+static aot_known_t *s_known(aot_t *aot, lv_t *sym) {
+    aot_known_t *known = NULL;
+    int index;
+
+    /* the last define wins */
+    for(index = 0; index < aot->nknown; index++)
+        if(!strcmp(L_SYM(aot->known[index].sym), L_SYM(sym)))
+            known = &aot->known[index];
+
+    return known;
+}
+
+/**
+ * write function fn, running body with formals bound.  The
+ * function is code for s_run, and is entered from lisp through
+ * a native that runs it there.
+ */
+static void s_function(aot_t *aot, int fn, lv_t *formals, lnode_t *body,
+                       int toplevel) {
+    aot_fn_t *outer = aot->cur;
+    aot_fn_t cur;
+    lv_t *vptr;
+    aot_var_t *var;
+    int min_args, max_args;
+    int index;
+
+    memset(&cur, 0, sizeof(cur));
+    cur.fn = fn;
+    cur.indent = 1;
+    cur.toplevel = toplevel;
+    s_arity(formals, &min_args, &max_args);
+    cur.params = safe_malloc(sizeof(int) * (min_args + 1));
+    cur.rest = max_args == LISP_ARGS_ANY;
+
+    aot->cur = &cur;
+    s_buf_open(&cur.body);
+
+    for(vptr = formals; vptr && vptr->type == l_pair; vptr = L_CDR(vptr))
+        cur.params[cur.nparams++] = s_bind(aot, L_CAR(vptr),
+                                           aot->next_var++);
+    if(cur.rest)
+        s_bind(aot, vptr, aot->next_var++);
+
+    s_emit(aot, body, NULL);
+
+    fclose(cur.body.f);
+    aot->cur = outer;
+
+    if(aot->fail) {
+        free(cur.body.data);
+        return;
+    }
+
+    fprintf(aot->code->f, "static lv_t *s_code_%d(lexec_t *exec, int argc, "
+            "lv_t **argv) {\n", fn);
+
+    for(index = 0; index < cur.nparams; index++)
+        fprintf(aot->code->f, "    lv_t *v%d = argv[%d];\n",
+                cur.params[index], index);
+    if(cur.rest)
+        fprintf(aot->code->f, "    lv_t *v%d = c_array_to_list(argc - %d, "
+                "argv + %d);\n", cur.vars->var, index, index);
+    for(var = cur.vars; var; var = var->next)
+        if(!var->used)
+            fprintf(aot->code->f, "    (void)v%d;\n", var->var);
+    if(cur.self_used)
+        fprintf(aot->code->f, "\ns_top:\n");
+
+    fwrite(cur.body.data, 1, cur.body.size, aot->code->f);
+    free(cur.body.data);
+
+    fprintf(aot->code->f, "}\n\n"
+            "static lv_t *s_fn_%d(lexec_t *exec, int argc, lv_t **argv) {\n"
+            "    return s_run(exec, s_code_%d, argc, argv);\n"
+            "}\n\n", fn, fn);
+
+    fprintf(aot->init->f, "    s_fns[%d] = lisp_create_argv_fn(s_fn_%d, %d, %d);\n"
+            "    s_codes[%d] = s_code_%d;\n", fn, fn, min_args, max_args,
+            fn, fn);
+}
+
+/*
+ * node emitters.  Each puts the value of its node in target, or
+ * returns it when target is NULL.
+ */
+
+static void s_emit_lambda(aot_t *aot, lnode_t *node, char *target) {
+    int fn = aot->nfns++;
+
+    s_function(aot, fn, node->value, node->body, 0);
+    s_put(aot, target, "s_fns[%d]", fn);
+}
+
+static void s_emit_define(aot_t *aot, lnode_t *node, char *target) {
+    lnode_t *value = node->argv[0];
+    char t[16];
+    int sym;
+
+    /* internal defines bind in an env */
+    if(!aot->cur->toplevel || aot->cur->vars) {
+        aot->fail = 1;
+        return;
+    }
+
+    sym = s_const(aot, node->value);
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_line(aot, "lv_t *%s;", t);
+
+    if(value->type == ln_lambda && aot->reserve >= 0) {
+        s_function(aot, aot->reserve, value->value, value->body, 0);
+        s_put(aot, t, "s_fns[%d]", aot->reserve);
+        aot->reserve = -1;
+    } else {
+        s_emit(aot, value, t);
+    }
+
+    s_line(aot, "if(%s->type == l_fn && !L_FN_BOUND(%s))", t, t);
+    s_line(aot, "    L_FN_BOUND(%s) = s_k[%d];", t, sym);
+    s_put(aot, target, "lisp_define(exec, s_k[%d], %s)", sym, t);
+    s_close(aot);
+}
+
+static void s_emit_begin(aot_t *aot, lnode_t *node, char *target) {
+    int index;
+
+    for(index = 0; index < node->argc - 1; index++)
+        s_emit(aot, node->argv[index], s_discard);
+    s_emit(aot, node->argv[node->argc - 1], target);
+}
+
+static void s_emit_if(aot_t *aot, lnode_t *node, char *target) {
+    char t[16];
+
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_line(aot, "lv_t *%s;", t);
+    s_emit(aot, node->argv[0], t);
+
+    s_open(aot, "if(S_FALSE(%s))", t);
+    s_emit(aot, node->argv[2], target);
+    aot->cur->indent--;
+    s_open(aot, "} else");
+    s_emit(aot, node->argv[1], target);
+    s_close(aot);
+
+    s_close(aot);
+}
+
+static void s_emit_logical(aot_t *aot, lnode_t *node, int index,
+                           char *target) {
+    char t[16];
+
+    if(index == node->argc - 1) {
+        s_emit(aot, node->argv[index], target);
+        return;
+    }
+
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_line(aot, "lv_t *%s;", t);
+    s_emit(aot, node->argv[index], t);
+
+    s_open(aot, node->type == ln_and ? "if(S_FALSE(%s))" :
+           "if(!S_FALSE(%s))", t);
+    s_put(aot, target, "%s", t);
+    aot->cur->indent--;
+    s_open(aot, "} else");
+    s_emit_logical(aot, node, index + 1, target);
+    s_close(aot);
+
+    s_close(aot);
+}
+
+static void s_emit_let(aot_t *aot, lnode_t *node, char *target) {
+    aot_var_t *vars = aot->cur->vars;
+    int var[node->argc + 1];
+    char v[16];
+    lv_t *names = node->scope->names;
+    aot_buf_t code;
+    FILE *f;
+    int index;
+
+    s_open(aot, "");
+    f = s_hold(aot, &code);
+
+    for(index = 0; index < node->argc; index++)
+        var[index] = aot->next_var++;
+
+    /* let inits run outside the new scope, let* inits see the
+     * bindings before them */
+    for(index = 0; index < node->argc; index++, names = L_CDR(names)) {
+        snprintf(v, sizeof(v), "v%d", var[index]);
+        s_emit(aot, node->argv[index], v);
+        if(node->type == ln_let_star)
+            s_bind(aot, L_CAR(names), var[index]);
+    }
+
+    if(node->type == ln_let)
+        for(index = 0, names = node->scope->names; index < node->argc;
+            index++, names = L_CDR(names))
+            s_bind(aot, L_CAR(names), var[index]);
+
+    s_emit(aot, node->body, target);
+
+    s_declare(aot, f, vars, var, node->argc, &code);
+    s_close(aot);
+
+    aot->cur->vars = vars;
+}
+
+static void s_emit_set(aot_t *aot, lnode_t *node, char *target) {
+    char t[16];
+    int var;
+
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_line(aot, "lv_t *%s;", t);
+    s_emit(aot, node->argv[0], t);
+
+    if(node->body->type == ln_local && (var = s_var(aot, node->value)) != -1) {
+        s_line(aot, "v%d = %s;", var, t);
+        s_put(aot, target, "lisp_create_null()");
+    } else if(node->body->type == ln_global) {
+        s_put(aot, target, "s_set(exec, &s_g[%d], %s)",
+              s_global(aot, node->value), t);
+    } else {
+        aot->fail = 1;
+    }
+
+    s_close(aot);
+}
+
+static void s_emit_case(aot_t *aot, lnode_t *node, char *target) {
+    lv_t *clause, *datum;
+    char t[16];
+    int index = 1;
+    int open = 0;
+    int first;
+
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_line(aot, "lv_t *%s;", t);
+    s_emit(aot, node->argv[0], t);
+
+    for(clause = node->value; clause; clause = L_CDR(clause), index++) {
+        /* else */
+        if(L_CAR(clause)->type == l_sym)
+            break;
+
+        if(L_CAR(clause)->type != l_pair)
+            continue;
+
+        fprintf(aot->cur->body.f, "%*sif(", aot->cur->indent * 4, "");
+        for(first = 1, datum = L_CAR(clause); datum; datum = L_CDR(datum)) {
+            fprintf(aot->cur->body.f, "%sc_equalp(%s, s_k[%d])",
+                    first ? "" : " || ", t, s_const(aot, L_CAR(datum)));
+            first = 0;
+        }
+        fputs(") {\n", aot->cur->body.f);
+        aot->cur->indent++;
+
+        s_emit(aot, node->argv[index], target);
+        aot->cur->indent--;
+        s_open(aot, "} else");
+        open++;
+    }
+
+    if(clause)
+        s_emit(aot, node->argv[index], target);
+    else
+        s_put(aot, target, "lisp_create_null()");
+
+    while(open--)
+        s_close(aot);
+
+    s_close(aot);
+}
+
+static void s_emit_do(aot_t *aot, lnode_t *node, char *target) {
+    aot_var_t *vars = aot->cur->vars;
+    int count = (node->argc - 3) / 2;
+    lnode_t **inits = node->argv + 3;
+    lnode_t **steps = inits + count;
+    int var[count + 1];
+    lv_t *names;
+    char t[16], s[16], buf[32];
+    aot_buf_t code;
+    FILE *f;
+    int index;
+
+    s_open(aot, "");
+    s_temp(aot, t, sizeof(t));
+    s_temp(aot, s, sizeof(s));
+    s_line(aot, "lv_t *%s, *%s[%d];", t, s, count + 1);
+    f = s_hold(aot, &code);
+
+    for(index = 0; index < count; index++)
+        var[index] = aot->next_var++;
+
+    for(index = 0; index < count; index++) {
+        snprintf(buf, sizeof(buf), "v%d", var[index]);
+        s_emit(aot, inits[index], buf);
+    }
+
+    for(index = 0, names = node->scope->names; index < count;
+        index++, names = L_CDR(names))
+        s_bind(aot, L_CAR(names), var[index]);
+
+    s_open(aot, "while(1)");
+    s_emit(aot, node->argv[0], t);
+
+    s_open(aot, "if(!S_FALSE(%s))", t);
+    s_emit(aot, node->argv[1], target);
+    if(target)
+        s_line(aot, "break;");
+    s_close(aot);
+
+    s_emit(aot, node->argv[2], s_discard);
+
+    /* steps all see the values of the last pass */
+    for(index = 0; index < count; index++) {
+        snprintf(buf, sizeof(buf), "%s[%d]", s, index);
+        s_emit(aot, steps[index], buf);
+    }
+    for(index = 0; index < count; index++)
+        s_line(aot, "v%d = %s[%d];", var[index], s, index);
+
+    s_close(aot);
+    s_declare(aot, f, vars, var, count, &code);
+    s_close(aot);
+
+    aot->cur->vars = vars;
+}
+
+/**
+ * is the operator of an apply a macro, now or by the time the
+ * program runs?
+ */
+static int s_is_macro(aot_t *aot, lnode_t *op) {
+    lv_t *fn, *vptr;
+
+    if(op->type != ln_global)
+        return 0;
+
+    for(vptr = aot->macros; vptr; vptr = L_CDR(vptr))
+        if(!strcmp(L_SYM(L_CAR(vptr)), L_SYM(op->value)))
+            return 1;
+
+    fn = lisp_static_global(aot->exec, op);
+    return fn && fn->type == l_fn && L_FN_FTYPE(fn) == lf_macro;
+}
+
+/**
+ * calls.  A call to a lambda defined at top level checks that
+ * the global still holds the compiled function, and if so runs
+ * its code without going through lisp at all.  A self call in
+ * tail position is a jump.
+ */
+static void s_emit_apply(aot_t *aot, lnode_t *node, char *target) {
+    aot_known_t *known = NULL;
+    char f[16], a[16], buf[32];
+    int index;
+
+    if(s_is_macro(aot, node->body)) {
+        aot->fail = 1;
+        return;
+    }
+
+    if(node->body->type == ln_global &&
+       (known = s_known(aot, node->body->value)) &&
+       (node->argc < known->min_args ||
+        (known->max_args != LISP_ARGS_ANY && node->argc > known->max_args)))
+        known = NULL;
+
+    s_open(aot, "");
+    s_temp(aot, f, sizeof(f));
+    s_temp(aot, a, sizeof(a));
+    s_line(aot, "lv_t *%s, *%s[%d];", f, a, node->argc + 1);
+
+    s_emit(aot, node->body, f);
+    for(index = 0; index < node->argc; index++) {
+        snprintf(buf, sizeof(buf), "%s[%d]", a, index);
+        s_emit(aot, node->argv[index], buf);
+    }
+
+    if(known && !target && known->fn == aot->cur->fn && !aot->cur->rest) {
+        s_open(aot, "if(%s == s_fns[%d])", f, known->fn);
+        for(index = 0; index < node->argc; index++)
+            s_line(aot, "v%d = %s[%d];", aot->cur->params[index], a, index);
+        s_line(aot, "goto s_top;");
+        s_close(aot);
+        aot->cur->self_used = 1;
+    } else if(known && !target) {
+        s_line(aot, "if(%s == s_fns[%d])", f, known->fn);
+        s_line(aot, "    return s_tail(%s, s_codes[%d], %d, %s);", f,
+               known->fn, node->argc, a);
+    } else if(known) {
+        s_open(aot, "if(%s == s_fns[%d])", f, known->fn);
+        s_line(aot, "lisp_exec_push_eval(exec, %s);", f);
+        s_put(aot, target, "s_run(exec, s_codes[%d], %d, %s)",
+              known->fn, node->argc, a);
+        s_line(aot, "lisp_exec_pop_eval(exec);");
+        s_close(aot);
+        s_line(aot, "else");
+        aot->cur->indent++;
+    }
+
+    s_put(aot, target, "lisp_exec_argv(exec, %s, %d, %s)", f, node->argc, a);
+    if(known && target)
+        aot->cur->indent--;
+
+    s_close(aot);
+}
+
+static void s_emit(aot_t *aot, lnode_t *node, char *target) {
+    int var;
+
+    if(aot->fail)
+        return;
+
+    switch(node->type) {
+    case ln_const:
+        s_put(aot, target, "s_k[%d]", s_const(aot, node->value));
+        break;
+    case ln_local:
+        if((var = s_var_read(aot, node->value)) == -1)
+            aot->fail = 1;   /* from an enclosing lambda */
+        else
+            s_put(aot, target, "v%d", var);
+        break;
+    case ln_global:
+        s_put(aot, target, "s_global(exec, &s_g[%d])",
+              s_global(aot, node->value));
+        break;
+    case ln_define:
+        s_emit_define(aot, node, target);
+        break;
+    case ln_lambda:
+        s_emit_lambda(aot, node, target);
+        break;
+    case ln_begin:
+        s_emit_begin(aot, node, target);
+        break;
+    case ln_if:
+        s_emit_if(aot, node, target);
+        break;
+    case ln_let:
+    case ln_let_star:
+        s_emit_let(aot, node, target);
+        break;
+    case ln_set:
+        s_emit_set(aot, node, target);
+        break;
+    case ln_and:
+    case ln_or:
+        s_emit_logical(aot, node, 0, target);
+        break;
+    case ln_case:
+        s_emit_case(aot, node, target);
+        break;
+    case ln_do:
+        s_emit_do(aot, node, target);
+        break;
+    case ln_apply:
+    case ln_fold:
+        /* folds are made again when the program loads */
+        s_emit_apply(aot, node, target);
+        break;
+    default:
+        /* dynamic refs, macros, and quasiquote need an env */
+        aot->fail = 1;
+        break;
+    }
+}
+
+/*
+ * top level
+ */
+
+static int s_is_form(lv_t *v, lisp_form_t form) {
+    return v && v->type == l_pair && L_CAR(v)->type == l_sym &&
+        L_SYM_FORM(L_CAR(v)) == form;
+}
+
+/**
+ * find the lambdas and macros defined at top level
+ */
+static void s_scan(aot_t *aot, lv_t *forms) {
+    aot_known_t *known;
+    lv_t *form;
+    int index = 0;
+
+    aot->known = safe_malloc(sizeof(aot_known_t) * (c_list_length(forms) + 1));
+
+    for(; forms && forms->type == l_pair; forms = L_CDR(forms), index++) {
+        form = L_CAR(forms);
+
+        if(s_is_form(form, lsf_defmacro) && L_CDR(form) &&
+           L_CADR(form)->type == l_sym)
+            aot->macros = lisp_create_pair(L_CADR(form), aot->macros);
+
+        if(s_is_form(form, lsf_define) && c_list_length(form) == 3 &&
+           L_CADR(form)->type == l_sym && s_is_form(L_CADDR(form), lsf_lambda) &&
+           c_list_length(L_CADDR(form)) == 3) {
+            known = &aot->known[aot->nknown++];
+            known->sym = L_CADR(form);
+            known->form = index;
+            known->fn = aot->nfns++;
+            s_arity(L_CADR(L_CADDR(form)), &known->min_args, &known->max_args);
+        }
+    }
+}
+
+/**
+ * expand and analyze a top level form the way load would, or
+ * return NULL if that raises an error
+ */
+static lnode_t *s_analyze_form(aot_t *aot, lv_t *form) {
+    lexec_t *exec = aot->exec;
+    lstack_t *eval_stack = exec->eval_stack;
+    lv_t *env = exec->env;
+    lnode_t *node;
+    jmp_buf jb;
+
+    lisp_exec_push_ex(exec, &jb);
+
+    if(setjmp(jb) == 0) {
+        node = lisp_analyze(exec, lisp_expand(exec, form));
+        lisp_exec_pop_ex(exec);
+        return node;
+    }
+
+    exec->env = env;
+    exec->eval_stack = eval_stack;
+    exec->exc = le_success;
+    exec->msg = NULL;
+
+    return NULL;
+}
+
+/**
+ * does running form change how later forms expand?  Those are
+ * run at compile time as well.
+ */
+static int s_compile_time(aot_t *aot, lnode_t *node) {
+    lv_t *fn;
+
+    if(node->type == ln_defmacro)
+        return 1;
+
+    if(node->type != ln_apply || node->body->type != ln_global)
+        return 0;
+
+    fn = lisp_static_global(aot->exec, node->body);
+    return fn && fn->type == l_fn && L_FN_FTYPE(fn) == lf_native &&
+        L_FN(fn) == p_dynamic_macro;
+}
+
+/**
+ * compile one top level form into a function run for it at
+ * startup, returning 0 if it has to be left to the interpreter
+ */
+static int s_toplevel(aot_t *aot, lnode_t *node, int index) {
+    aot_buf_t code, init;
+    int nconsts = aot->nconsts;
+    int nglobals = aot->nglobals;
+    lv_t *globals = aot->globals;
+    int nfns = aot->nfns;
+    int known;
+    int fn;
+
+    aot->reserve = -1;
+    for(known = 0; known < aot->nknown; known++)
+        if(aot->known[known].form == index)
+            aot->reserve = aot->known[known].fn;
+
+    s_buf_open(&code);
+    s_buf_open(&init);
+    aot->code = &code;
+    aot->init = &init;
+    aot->fail = 0;
+
+    fn = aot->nfns++;
+    s_function(aot, fn, NULL, node, 1);
+
+    if(aot->fail) {
+        s_buf_close(&code, NULL);
+        s_buf_close(&init, NULL);
+        aot->nconsts = nconsts;
+        aot->nglobals = nglobals;
+        aot->globals = globals;
+        aot->nfns = nfns;
+    } else {
+        s_buf_close(&code, &aot->all_code);
+        s_buf_close(&init, &aot->all_init);
+        fprintf(aot->all_main.f, "    if(!s_eval(exec, lisp_create_pair("
+                "s_fns[%d], NULL)))\n        return EXIT_FAILURE;\n", fn);
+    }
+
+    aot->code = &aot->all_code;
+    aot->init = &aot->all_init;
+
+    return !aot->fail;
+}
+
+/**
+ * compile the top level forms of a program to a C program that
+ * runs them.  The program is linked with libminischeme, and
+ * given -t, runs the tests the forms define as selfcheck would.
+ */
+int lisp_aot_compile(lexec_t *exec, lv_t *forms, char *source, FILE *out) {
+    aot_t aot;
+    lnode_t *node;
+    lv_t *form;
+    int index = 0;
+    int compiled = 0;
+    int total = 0;
+
+    assert(exec && forms && out);
+    assert(forms->type == l_pair || forms->type == l_null);
+
+    memset(&aot, 0, sizeof(aot));
+    aot.exec = exec;
+    s_buf_open(&aot.all_code);
+    s_buf_open(&aot.all_init);
+    s_buf_open(&aot.all_main);
+    aot.code = &aot.all_code;
+    aot.init = &aot.all_init;
+
+    if(forms->type == l_null)
+        forms = NULL;
+
+    s_scan(&aot, forms);
+
+    for(; forms; forms = L_CDR(forms), index++) {
+        form = L_CAR(forms);
+        total++;
+
+        node = s_analyze_form(&aot, form);
+        if(node && !s_compile_time(&aot, node) && s_toplevel(&aot, node, index)) {
+            compiled++;
+            continue;
+        }
+
+        aot.fail = 0;
+        fprintf(aot.all_main.f, "    if(!s_eval(exec, s_k[%d]))\n"
+                "        return EXIT_FAILURE;\n", s_const(&aot, form));
+        if(aot.fail) {
+            fprintf(stderr, "%s: form %d can't be written as C\n",
+                    source, index + 1);
+            return 0;
+        }
+
+        if(node && s_compile_time(&aot, node))
+            lisp_execute(exec, lisp_create_pair(form, NULL));
+    }
+
+    fclose(aot.all_code.f);
+    fclose(aot.all_init.f);
+    fclose(aot.all_main.f);
+
+    fprintf(out, "/* %s, compiled by minischeme -c.  %d of %d top level\n"
+            " * forms are compiled, the rest are run by the interpreter. */\n\n"
+            "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n\n"
+            "#include \"lisp-types.h\"\n#include \"primitives.h\"\n"
+            "#include \"builtins.h\"\n#include \"parser.h\"\n\n",
+            source, compiled, total);
+    fputs(s_preamble, out);
+    fprintf(out, "static lv_t *s_k[%d];\nstatic s_global_t s_g[%d];\n"
+            "static lv_t *s_fns[%d];\nstatic s_code_t s_codes[%d];\n\n",
+            aot.nconsts + 1, aot.nglobals + 1, aot.nfns + 1, aot.nfns + 1);
+    fwrite(aot.all_code.data, 1, aot.all_code.size, out);
+    fprintf(out, "static void s_init(lexec_t *exec) {\n");
+    fwrite(aot.all_init.data, 1, aot.all_init.size, out);
+    fprintf(out, "}\n\n"
+            "int main(int argc, char *argv[]) {\n"
+            "    lexec_t *exec = lisp_context_new(5);\n\n"
+            "    s_env = exec->env;\n"
+            "    s_init(exec);\n\n");
+    fwrite(aot.all_main.data, 1, aot.all_main.size, out);
+    fprintf(out, "\n"
+            "    if(argc > 1 && !strcmp(argv[1], \"-t\")) {\n"
+            "        s_test_exec = exec;\n"
+            "        lisp_set_ehandler(exec, null_ehandler);\n"
+            "        c_hash_walk(L_CAR(exec->env), s_test);\n"
+            "        return s_test_failed ? EXIT_FAILURE : EXIT_SUCCESS;\n"
+            "    }\n\n"
+            "    return EXIT_SUCCESS;\n"
+            "}\n");
+
+    free(aot.all_code.data);
+    free(aot.all_init.data);
+    free(aot.all_main.data);
+
+    return 1;
+}
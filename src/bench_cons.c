@@ -0,0 +1,127 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * cons allocation rate: pairs made one GC_malloc at a time, as
+ * lisp_create_pair makes them, against pairs popped off a free
+ * list that GC_malloc_many refills in bulk.  Run with "make bench".
+ * The figures only mean something against the real collector, so
+ * the version linked is printed with them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <gc.h>
+
+#include "lisp-types.h"
+#include "primitives.h"
+
+#define BENCH_LIST   1000       /* cells per list, then dropped */
+#define BENCH_CELLS  20000000
+#define BENCH_RUNS   3          /* best of, each path in turn */
+
+static double s_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* free pair cells, linked through their first word.  A static,
+ * so the collector sees the cells not handed out yet as live. */
+static void *s_pair_cells;
+
+/**
+ * a pair from the free list, refilled a batch at a time
+ */
+static lv_t *s_many_pair(lv_t *car, lv_t *cdr) {
+    lv_t *result;
+
+    if(!s_pair_cells) {
+        s_pair_cells = GC_malloc_many(LV_SIZE(p));
+        if(!s_pair_cells) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    result = s_pair_cells;
+    s_pair_cells = GC_NEXT(s_pair_cells);
+    GC_NEXT(result) = NULL;
+
+    result->type = l_pair;
+    L_CAR(result) = car;
+    L_CDR(result) = cdr;
+
+    return result;
+}
+
+/**
+ * time BENCH_CELLS conses, starting from a collected heap so
+ * neither path inherits the other's garbage
+ */
+static double s_run(lv_t *(*cons)(lv_t *, lv_t *)) {
+    lv_t *item = lisp_create_int(1);
+    lv_t *list = NULL;
+    double start;
+    long index;
+
+    GC_gcollect();
+
+    start = s_now();
+    for(index = 0; index < BENCH_CELLS; index++) {
+        if(index % BENCH_LIST == 0)
+            list = NULL;
+        list = cons(item, list);
+    }
+
+    return s_now() - start;
+}
+
+static void s_report(char *name, double elapsed) {
+    printf("%-20s %8.2f Mcells/s  (%.3fs)\n", name,
+           BENCH_CELLS / elapsed / 1e6, elapsed);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned version = GC_get_version();
+    double before = 0, after = 0, elapsed;
+    int run;
+
+    printf("gc %u.%u.%u, %d cells, best of %d\n", version >> 16,
+           (version >> 8) & 0xff, version & 0xff, BENCH_CELLS, BENCH_RUNS);
+
+    for(run = 0; run < BENCH_RUNS; run++) {
+        elapsed = s_run(lisp_create_pair);
+        if(!run || elapsed < before)
+            before = elapsed;
+
+        elapsed = s_run(s_many_pair);
+        if(!run || elapsed < after)
+            after = elapsed;
+    }
+
+    s_report("lisp_create_pair", before);
+    s_report("GC_malloc_many list", after);
+    printf("speedup              %8.2fx\n", before / after);
+
+    return EXIT_SUCCESS;
+}
@@ -27,24 +27,20 @@
 #include "primitives.h"
 #include "builtins.h"
 #include "parser.h"
+#include "analyze.h"
 
 static lv_t *s_is_type(lv_t *v, lisp_type_t t) {
-    if(v->type == t)
-        return lisp_create_bool(1);
-    return lisp_create_bool(0);
+    return v->type == t ? LISP_TRUE : LISP_FALSE;
 }
 
-lv_t *p_nullp(lexec_t *exec, lv_t *v) {
-    assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
-    lv_t *a0 = L_CAR(v);
+lv_t *p_nullp(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    return s_is_type(a0, l_null);
+    return s_is_type(argv[0], l_null);
 }
 
 lv_t *p_symbolp(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
     lv_t *a0 = L_CAR(v);
 
     return s_is_type(a0, l_sym);
@@ -52,7 +48,6 @@ lv_t *p_symbolp(lexec_t *exec, lv_t *v) {
 
 lv_t *p_atomp(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
     lv_t *a0 = L_CAR(v);
 
     if(a0->type != l_pair)
@@ -62,7 +57,6 @@ lv_t *p_atomp(lexec_t *exec, lv_t *v) {
 
 lv_t *p_consp(lexec_t *exec, lv_t *v) {
     assert(v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
     lv_t *a0 = L_CAR(v);
 
     return s_is_type(a0, l_pair);
@@ -70,7 +64,6 @@ lv_t *p_consp(lexec_t *exec, lv_t *v) {
 
 lv_t *p_listp(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
     lv_t *a0 = L_CAR(v);
 
     if((a0->type == l_pair) || (a0->type == l_null))
@@ -78,12 +71,10 @@ lv_t *p_listp(lexec_t *exec, lv_t *v) {
     return lisp_create_bool(0);
 }
 
-lv_t *p_pairp(lexec_t *exec, lv_t *v) {
-    assert(v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
-    lv_t *a0 = L_CAR(v);
+lv_t *p_pairp(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    return lisp_create_bool(a0->type == l_pair);
+    return lisp_create_bool(argv[0]->type == l_pair);
 }
 
 /**
@@ -97,15 +88,17 @@ int c_equalp(lv_t *a1, lv_t *a2) {
 
     switch(a1->type) {
     case l_int:
-        result = (mpz_cmp(L_INT(a1), L_INT(a2)) == 0);
+        result = (lisp_int_cmp(a1, a2) == 0);
         break;
     case l_float:
-        result = (mpfr_cmp(L_FLOAT(a1), L_FLOAT(a2)) == 0);
+        result = (L_FLOAT(a1) == L_FLOAT(a2));
+        break;
+    case l_bigfloat:
+        result = (mpfr_equal_p(L_BIGFLOAT(a1), L_BIGFLOAT(a2)) != 0);
         break;
     case l_bool:
-        if((L_BOOL(a1) == 0 && L_BOOL(a2) == 0) ||
-           (L_BOOL(a1) != 0 && L_BOOL(a1) != 0))
-            result = 1;
+    case l_char:
+        result = (a1 == a2);
         break;
     case l_sym:
         if(strcmp(L_SYM(a1), L_SYM(a2)) == 0)
@@ -118,6 +111,9 @@ int c_equalp(lv_t *a1, lv_t *a2) {
     case l_hash:
         result = (L_HASH(a1) == L_HASH(a2));
         break;
+    case l_frame:
+        result = (a1 == a2);
+        break;
     case l_null:
         result = 1;
         break;
@@ -142,25 +138,18 @@ int c_equalp(lv_t *a1, lv_t *a2) {
 /**
  * lisp wrapper around c_equalp
  */
-lv_t *p_equalp(lexec_t *exec, lv_t *v) {
-    int result;
-
-    assert(v && exec);
-    rt_assert(c_list_length(v) == 2, le_arity, "wrong arity");
-
-    lv_t *a1 = L_CAR(v);
-    lv_t *a2 = L_CADR(v);
+lv_t *p_equalp(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    return(lisp_create_bool(c_equalp(a1, a2)));
+    return(lisp_create_bool(c_equalp(argv[0], argv[1])));
 }
 
 lv_t *p_set_cdr(lexec_t *exec, lv_t *v) {
     assert(v && exec);
 
-    rt_assert(c_list_length(v) == 2, le_arity, "set-cdr arity");
     rt_assert(L_CAR(v)->type == l_pair, le_type, "set-cdr on non-pair");
 
-    if(L_CADR(v)->type == l_null)
+    if(L_CADR(v) == LISP_NULL)
         L_CDR(L_CAR(v)) = NULL;
     else
         L_CDR(L_CAR(v)) = L_CADR(v);
@@ -171,7 +160,6 @@ lv_t *p_set_cdr(lexec_t *exec, lv_t *v) {
 lv_t *p_set_car(lexec_t *exec, lv_t *v) {
     assert(v && exec);
 
-    rt_assert(c_list_length(v) == 2, le_arity, "set-cdr arity");
     rt_assert(L_CAR(v)->type == l_pair, le_type, "set-car on non-pair");
 
     L_CAR(L_CAR(v)) = L_CADR(v);
@@ -181,10 +169,11 @@ lv_t *p_set_car(lexec_t *exec, lv_t *v) {
 lv_t *p_inspect(lexec_t *exec, lv_t *v) {
     lv_t *arg;
     int show_line = 1;
+    int row, col;
+    char *file;
     char buffer[256];
 
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "inspect arity");
 
     arg = L_CAR(v);
     memset(buffer, 0, sizeof(buffer));
@@ -192,30 +181,29 @@ lv_t *p_inspect(lexec_t *exec, lv_t *v) {
     strcat(buffer, "type: ");
 
     if(arg->type == l_fn) {
-        if(L_FN(arg)) {
+        if(L_FN_FTYPE(arg) == lf_native) {
             strcat(buffer, "built-in function");
             show_line = 0;
         } else {
-            strcat(buffer, "lambda, declared at");
+            strcat(buffer, "lambda");
         }
     } else {
         strcat(buffer, lisp_types_list[arg->type] + 2);
     }
 
-    if(show_line)
-        sprintf(buffer + strlen(buffer), " %s:%d:%d",
-                arg->file, arg->row, arg->col);
+    if(show_line && lisp_value_pos(arg, &row, &col, &file))
+        sprintf(buffer + strlen(buffer), ", declared at %s:%d:%d",
+                file, row, col);
 
-    if(arg->bound)
+    if(arg->type == l_fn && L_FN_BOUND(arg))
         sprintf(buffer + strlen(buffer), ", bound to: %s",
-                L_SYM(arg->bound));
+                L_SYM(L_FN_BOUND(arg)));
 
     return lisp_create_string(buffer);
 }
 
 lv_t *p_load(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "load arity");
     rt_assert(L_CAR(v)->type == l_str, le_type, "filename must be string");
 
     return c_sequential_eval(exec, c_parse_file(exec, L_STR(L_CAR(v))));
@@ -224,13 +212,11 @@ lv_t *p_load(lexec_t *exec, lv_t *v) {
 lv_t *p_length(lexec_t *exec, lv_t *v) {
     assert(v && exec);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "length arity");
     return lisp_create_int(c_list_length(L_CAR(v)));
 }
 
 lv_t *p_assert(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "assert arity");
     rt_assert(L_CAR(v)->type == l_bool, le_type, "assert not bool");
 
     if(!L_BOOL(L_CAR(v)))
@@ -241,7 +227,6 @@ lv_t *p_assert(lexec_t *exec, lv_t *v) {
 
 lv_t *p_warn(lexec_t *exec, lv_t *v) {
     assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "warn arity");
     rt_assert(L_CAR(v)->type == l_bool, le_type, "warn not bool");
 
     if(!L_BOOL(L_CAR(v)))
@@ -250,43 +235,36 @@ lv_t *p_warn(lexec_t *exec, lv_t *v) {
     return lisp_create_null();
 }
 
-lv_t *p_not(lexec_t *exec, lv_t *v) {
-    assert(v && exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "not arity");
-    rt_assert(L_CAR(v)->type == l_bool, le_type, "not bool");
+lv_t *p_not(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
+    rt_assert(argv[0]->type == l_bool, le_type, "not bool");
 
-    return lisp_create_bool(!(L_BOOL(L_CAR(v))));
+    return lisp_create_bool(!(L_BOOL(argv[0])));
 }
 
-lv_t *p_car(lexec_t *exec, lv_t *v) {
-    assert(v && exec);
-
-    rt_assert(c_list_length(v) == 1, le_arity, "car arity");
-    rt_assert(L_CAR(v)->type == l_pair, le_type, "car on non-list");
+lv_t *p_car(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    if(L_CAAR(v)->type == l_null)
-        return lisp_create_null();
+    rt_assert(argv[0]->type == l_pair, le_type, "car on non-list");
 
-    return L_CAAR(v);
+    return L_CAR(argv[0]);
 }
 
-lv_t *p_cdr(lexec_t *exec, lv_t *v) {
-    assert(v && exec);
+lv_t *p_cdr(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "cdr arity");
-    rt_assert(L_CAR(v)->type == l_pair, le_type, "cdr on non-list");
+    rt_assert(argv[0]->type == l_pair, le_type, "cdr on non-list");
 
-    if(L_CDAR(v) == NULL)
+    if(L_CDR(argv[0]) == NULL)
         return lisp_create_null();
 
-    return L_CDAR(v);
+    return L_CDR(argv[0]);
 }
 
-lv_t *p_cons(lexec_t *exec, lv_t *v) {
-    assert(v && exec);
+lv_t *p_cons(lexec_t *exec, int argc, lv_t **argv) {
+    assert(exec);
 
-    rt_assert(c_list_length(v) == 2, le_arity, "cons arity");
-    return lisp_create_pair(L_CAR(v), L_CADR(v));
+    return lisp_create_pair(argv[0], argv[1]);
 }
 
 /**
@@ -298,12 +276,319 @@ lv_t *p_gensym(lexec_t *exec, lv_t *v) {
 
     assert(v && (v->type == l_pair || v->type == l_null));
 
-    rt_assert(c_list_length(v) == 0, le_arity, "gensym arity");
     snprintf(buffer, sizeof(buffer), "<gensym-%05d>", sym_no++);
 
     return lisp_create_symbol(buffer);
 }
 
+/**
+ * (cache-stats)
+ *
+ * returns a list of the lookup cache hits and misses
+ * for this context
+ */
+lv_t *p_cache_stats(lexec_t *exec, lv_t *v) {
+    assert(v && (v->type == l_pair || v->type == l_null));
+
+    return c_make_list(lisp_create_int(exec->ic_hits),
+                       lisp_create_int(exec->ic_misses), NULL);
+}
+
+/**
+ * (backtrace)
+ *
+ * returns the functions being run, innermost first.  The eval
+ * stack is shared with the running calls rather than copied
+ * from the C stack, so this is cheap at any depth.
+ */
+lv_t *p_backtrace(lexec_t *exec, lv_t *v) {
+    lv_t *result = lisp_create_null();
+    lv_t *tail = NULL, *pair;
+    lstack_t *pstack;
+
+    assert(v && (v->type == l_pair || v->type == l_null));
+    assert(exec->eval_stack);
+
+    /* skip ourselves */
+    for(pstack = exec->eval_stack->next; pstack; pstack = pstack->next) {
+        pair = lisp_create_pair(pstack->data, lisp_create_null());
+        if(tail)
+            L_CDR(tail) = pair;
+        else
+            result = pair;
+        tail = pair;
+    }
+
+    return result;
+}
+
+/**
+ * (dynamic-macro macro)
+ *
+ * mark a macro as depending on dynamic state, so each use is
+ * expanded every time it runs rather than once.  returns the macro
+ */
+lv_t *p_dynamic_macro(lexec_t *exec, lv_t *v) {
+    lv_t *macro;
+
+    assert(v && exec);
+
+    macro = L_CAR(v);
+    rt_assert(macro->type == l_fn && L_FN_FTYPE(macro) == lf_macro,
+              le_type, "not a macro");
+
+    L_FN_DYNAMIC(macro) = 1;
+    return macro;
+}
+
+/**
+ * a continuation: the context call/cc was called in, and the
+ * jump back into it.  While the call/cc is waiting on its fn the
+ * C stack above it is left as it is, so a jump is enough to
+ * return from it.  If something jumps out past it, that stack is
+ * about to be reused, so it is copied to the heap first, and the
+ * call/cc can be resumed once from the copy.
+ */
+struct lcont_t {
+    jmp_buf jb;
+    lv_t *value;
+    lv_t *env;
+    lstack_t *env_stack;
+    lstack_t *ex_stack;
+    lstack_t *eval_stack;   // with call/cc on top, while it runs
+    lstack_t *wind_stack;
+    lregion_t region;
+
+    int done;               // the call/cc has returned
+    char *mark;             // C stack below the call/cc,
+    char *base;             // up to exec->stack_base,
+    long *stack;            // and the copy of it once suspended
+    lcont_t *next;          // call/cc's entered before this one
+};
+
+/**
+ * the address of a frame below the caller's
+ */
+static char * __attribute__((noinline)) s_stack_mark(void) {
+    return __builtin_frame_address(0);
+}
+
+/**
+ * copy stack words.  Stack frames have redzones under ASan that
+ * are not ours to check, and the loop must not be made a memcpy.
+ */
+static void __attribute__((no_sanitize_address))
+s_stack_copy(long *to, long *from, size_t count) {
+    volatile long *dst = to;
+
+    while(count--)
+        *dst++ = *from++;
+}
+
+/**
+ * is the call/cc of k waiting on the C stack?  A call/cc left by
+ * an error is not, and has its entry gone from the eval stack.
+ */
+static int s_cont_live(lexec_t *exec, lcont_t *k) {
+    lstack_t *pstack;
+
+    if(k->done)
+        return 0;
+
+    for(pstack = exec->eval_stack; pstack; pstack = pstack->next)
+        if(pstack == k->eval_stack)
+            return 1;
+
+    return 0;
+}
+
+/**
+ * copy the C stack of a waiting call/cc before it is jumped
+ * past.  The frames in the region it uses are kept as well.
+ */
+static void s_cont_suspend(lexec_t *exec, lcont_t *k) {
+    size_t count;
+
+    if(!k->base || k->base != exec->stack_base)
+        return;
+
+    count = (k->base - k->mark) / sizeof(long);
+    k->stack = safe_malloc(count * sizeof(long));
+    s_stack_copy(k->stack, (long *)k->mark, count);
+
+    lisp_region_keep(exec);
+}
+
+/**
+ * put back the C stack of a suspended call/cc and jump into it
+ */
+static void __attribute__((noinline)) s_cont_jump(lcont_t *k) {
+    s_stack_copy((long *)k->mark, k->stack,
+                 (k->base - k->mark) / sizeof(long));
+    longjmp(k->jb, 1);
+}
+
+/**
+ * resume a suspended call/cc, first moving the stack pointer
+ * clear of the stack being put back
+ */
+static void s_cont_resume(lcont_t *k) {
+    char *here = s_stack_mark();
+    volatile char room[here > k->mark - 2048 ? here - k->mark + 2048 : 1];
+
+    room[0] = 0;
+    (void)room;
+    s_cont_jump(k);
+}
+
+/**
+ * run the dynamic-wind thunks to get from the current wind stack
+ * to target: afters of the ones being left, innermost first,
+ * then befores of the ones being entered, outermost first
+ */
+static void s_wind_to(lexec_t *exec, lstack_t *target, lv_t **argv) {
+    lstack_t *pstack;
+    lv_t *winder;
+
+    while(exec->wind_stack) {
+        for(pstack = target; pstack; pstack = pstack->next)
+            if(pstack == exec->wind_stack)
+                break;
+        if(pstack)
+            break;
+
+        winder = exec->wind_stack->data;
+        lisp_exec_pop_wind(exec);
+        lisp_exec_argv(exec, L_CDR(winder), 0, argv);
+    }
+
+    if(target == exec->wind_stack)
+        return;
+
+    s_wind_to(exec, target->next, argv);
+    lisp_exec_argv(exec, L_CAR((lv_t *)target->data), 0, argv);
+    exec->wind_stack = target;
+}
+
+/**
+ * invoke a continuation.  Natives are run with themselves on top
+ * of the eval stack, which is how we find which one this is.
+ */
+static lv_t *s_continue(lexec_t *exec, int argc, lv_t **argv) {
+    lcont_t *k = L_FN_DATA((lv_t *)exec->eval_stack->data);
+    lcont_t *c;
+    int live = s_cont_live(exec, k);
+
+    rt_assert(live || (k->stack && !k->done &&
+                       k->base == exec->stack_base), le_internal,
+              "continuation used after call/cc returned");
+
+    /* the call/cc's jumped past can be resumed later.  Resuming
+     * k replaces the whole stack, not just what is above k. */
+    for(c = exec->conts; c && c != k; c = c->next)
+        if(s_cont_live(exec, c))
+            s_cont_suspend(exec, c);
+
+    s_wind_to(exec, k->wind_stack, argv);
+
+    exec->env = k->env;
+    exec->env_stack = k->env_stack;
+    exec->ex_stack = k->ex_stack;
+    exec->eval_stack = k->eval_stack;
+    exec->conts = k;
+    k->value = argv[0];
+
+    if(live) {
+        lisp_region_release(exec, &k->region);
+        longjmp(k->jb, 1);
+    }
+
+    lisp_region_keep(exec);
+    s_cont_resume(k);
+    return NULL;
+}
+
+/**
+ * (call/cc fn)
+ *
+ * call fn with the current continuation.  Calling it while the
+ * call/cc is still waiting returns from the call/cc with its
+ * argument, unwinding with a jump, so an escape costs about what
+ * an error does.  A call/cc jumped past that way (by an escape to
+ * an outer one, say) has its stack copied first, and calling its
+ * continuation later resumes it, which is enough for generators.
+ * Continuations are one-shot: a call/cc only ever returns once.
+ */
+lv_t *p_call_cc(lexec_t *exec, int argc, lv_t **argv) {
+    lcont_t *k;
+    lv_t *kfn, *result;
+
+    assert(exec && argc == 1);
+    rt_assert(argv[0]->type == l_fn, le_type, "call/cc of a non-function");
+
+    k = safe_malloc(sizeof(lcont_t));
+    k->env = exec->env;
+    k->env_stack = exec->env_stack;
+    k->ex_stack = exec->ex_stack;
+    k->eval_stack = exec->eval_stack;
+    k->wind_stack = exec->wind_stack;
+    k->region = exec->region;
+    k->mark = (char *)((long)s_stack_mark() & ~15L);
+    k->base = exec->stack_base;
+    k->next = exec->conts;
+    exec->conts = k;
+
+    kfn = lisp_create_argv_fn(s_continue, 1, 1);
+    L_FN_DATA(kfn) = k;
+
+    if(setjmp(k->jb)) {
+        result = k->value;
+    } else {
+        result = lisp_exec_argv(exec, argv[0], 1, &kfn);
+
+        /* back through the frames of a call/cc resumed since */
+        rt_assert(!k->done, le_internal, "call/cc returned twice");
+    }
+
+    k->done = 1;
+    k->stack = NULL;
+    exec->conts = k->next;
+
+    return result;
+}
+
+/**
+ * (dynamic-wind before thunk after)
+ *
+ * call thunk between before and after.  after is also run when
+ * a continuation escapes out of thunk.
+ */
+lv_t *p_dynamic_wind(lexec_t *exec, int argc, lv_t **argv) {
+    lv_t *result;
+
+    assert(exec && argc == 3);
+
+    lisp_exec_argv(exec, argv[0], 0, argv);
+    lisp_exec_push_wind(exec, lisp_create_pair(argv[0], argv[2]));
+    result = lisp_exec_argv(exec, argv[1], 0, argv);
+    lisp_exec_pop_wind(exec);
+    lisp_exec_argv(exec, argv[2], 0, argv);
+
+    return result;
+}
+
+/**
+ * (expand form)
+ *
+ * return form with the macro uses in it expanded, as load
+ * does before evaluating each top-level form
+ */
+lv_t *p_expand(lexec_t *exec, lv_t *v) {
+    assert(v && exec);
+
+    return lisp_expand(exec, L_CAR(v));
+}
+
 /**
  * (display obj)
  * (display obj port)
@@ -318,8 +603,6 @@ lv_t *p_display(lexec_t *exec, lv_t *v) {
 
     assert(v && exec);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "display arity");
-
     str = lisp_str_from_value(exec, L_CAR(v), 1);
     fprintf(stdout, "%s", L_STR(str));
     fflush(stdout);
@@ -341,8 +624,6 @@ lv_t *p_write(lexec_t *exec, lv_t *v) {
 
     assert(v && exec);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "display arity");
-
     str = lisp_str_from_value(exec, L_CAR(v), 0);
     fprintf(stdout, "%s", L_STR(str));
     fflush(stdout);
@@ -21,14 +21,14 @@
 #ifndef __BUILTINS_H__
 #define __BUILTINS_H__
 
-extern lv_t *p_nullp(lexec_t *exec, lv_t *v);
+extern int c_equalp(lv_t *a1, lv_t *a2);
+extern lv_t *p_nullp(lexec_t *exec, int argc, lv_t **argv);
 extern lv_t *p_symbolp(lexec_t *exec, lv_t *v);
 extern lv_t *p_atomp(lexec_t *exec, lv_t *v);
 extern lv_t *p_consp(lexec_t *exec, lv_t *v);
 extern lv_t *p_listp(lexec_t *exec, lv_t *v);
-extern lv_t *p_pairp(lexec_t *exec, lv_t *v);
-extern lv_t *p_plus(lexec_t *exec, lv_t *v);
-extern lv_t *p_equalp(lexec_t *exec, lv_t *v);
+extern lv_t *p_pairp(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_equalp(lexec_t *exec, int argc, lv_t **argv);
 extern lv_t *p_set_cdr(lexec_t *exec, lv_t *v);
 extern lv_t *p_set_car(lexec_t *exec, lv_t *v);
 extern lv_t *p_inspect(lexec_t *exec, lv_t *v);
@@ -36,11 +36,17 @@ extern lv_t *p_load(lexec_t *exec, lv_t *v);
 extern lv_t *p_length(lexec_t *exec, lv_t *v);
 extern lv_t *p_assert(lexec_t *exec, lv_t *v);
 extern lv_t *p_warn(lexec_t *exec, lv_t *v);
-extern lv_t *p_not(lexec_t *exec, lv_t *v);
-extern lv_t *p_car(lexec_t *exec, lv_t *v);
-extern lv_t *p_cdr(lexec_t *exec, lv_t *v);
-extern lv_t *p_cons(lexec_t *exec, lv_t *v);
+extern lv_t *p_not(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_car(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_cdr(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_cons(lexec_t *exec, int argc, lv_t **argv);
 extern lv_t *p_gensym(lexec_t *exec, lv_t *v);
+extern lv_t *p_cache_stats(lexec_t *exec, lv_t *v);
+extern lv_t *p_backtrace(lexec_t *exec, lv_t *v);
+extern lv_t *p_dynamic_macro(lexec_t *exec, lv_t *v);
+extern lv_t *p_call_cc(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_dynamic_wind(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_expand(lexec_t *exec, lv_t *v);
 extern lv_t *p_display(lexec_t *exec, lv_t *v);
 extern lv_t *p_write(lexec_t *exec, lv_t *v);
 extern lv_t *p_format(lexec_t *exec, lv_t *v);
@@ -30,7 +30,6 @@ typedef enum char_comp_t { CC_EQ, CC_GT, CC_LT, CC_GTE, CC_LTE } char_comp_t;
 
 lv_t *p_charp(lexec_t *exec, lv_t *v) {
     assert(v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
     lv_t *a0 = L_CAR(v);
 
     if(a0->type != l_char)
@@ -42,7 +41,6 @@ lv_t *c_charcomp(lexec_t *exec, lv_t *v, char_comp_t how) {
     int res;
 
     assert(v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 2, le_arity, "wrong arity");
 
     lv_t *a0 = L_CAR(v);
     lv_t *a1 = L_CADR(v);
@@ -96,7 +94,6 @@ extern lv_t *p_chargtep(lexec_t *exec, lv_t *v) {
 
 extern lv_t *p_char_integer(lexec_t *exec, lv_t *v) {
     assert(v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "wrong arity");
 
     lv_t *a0 = L_CAR(v);
 
@@ -33,6 +33,13 @@
 (define car p-car)
 (define cdr p-cdr)
 (define gensym p-gensym)
+(define cache-stats p-cache-stats)
+(define backtrace p-backtrace)
+(define dynamic-macro p-dynamic-macro)
+(define call/cc p-call/cc)
+(define call-with-current-continuation p-call/cc)
+(define dynamic-wind p-dynamic-wind)
+(define expand p-expand)
 (define display p-display)
 (define write p-write)
 (define format p-format)
@@ -113,6 +120,7 @@
 (define real? p-float?)
 (define exact? p-exact?)
 (define inexact? p-inexact?)
+(define bigfloat p-bigfloat)
 (define > p->)
 (define < p-<)
 (define >= p->=)
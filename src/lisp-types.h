@@ -21,6 +21,8 @@
 #ifndef __LISP_TYPES_H__
 #define __LISP_TYPES_H__
 
+#include <stddef.h>
+#include <stdint.h>
 #include <gmp.h>
 #include <mpfr.h>
 
@@ -28,11 +30,13 @@
     C(l_int) \
     C(l_rational) \
     C(l_float) \
+    C(l_bigfloat) \
     C(l_bool) \
     C(l_sym) \
     C(l_str) \
     C(l_pair) \
     C(l_hash) \
+    C(l_frame) \
     C(l_null) \
     C(l_port) \
     C(l_char) \
@@ -81,6 +85,9 @@ typedef enum lisp_funtype_t {
     lf_macro
 } lisp_funtype_t;
 
+/* max_args of a function taking any number of arguments */
+#define LISP_ARGS_ANY -1
+
 typedef enum lisp_errsubtype_t {
     les_read,
     les_file,
@@ -89,17 +96,54 @@ typedef enum lisp_errsubtype_t {
 } lisp_errsubtype_t;
 
 typedef struct lv_t lv_t;
+typedef struct lnode_t lnode_t;          /* analyze.h */
+typedef struct lscope_t lscope_t;        /* analyze.h */
+typedef struct lcode_t lcode_t;          /* vm.h */
+typedef struct lmath_site_t lmath_site_t;  /* math.h */
+typedef struct lcont_t lcont_t;          /* builtins.c */
+
+typedef enum lisp_engine_t {
+    en_tree,    /* walk the analyzed node tree */
+    en_vm       /* compile to bytecode and run on the vm */
+} lisp_engine_t;
 
 typedef struct lstack_t {
     struct lstack_t *next;
     void *data;
 } lstack_t;
 
+/**
+ * a point in the frame region of a context, see
+ * lisp_region_alloc
+ */
+typedef struct lregion_t {
+    char *base;             // current chunk
+    size_t top;             // bytes used in it
+} lregion_t;
+
 typedef struct lexec_t {
     lv_t *env;              // current working environment
     lstack_t *env_stack;    // environment stack
     lstack_t *ex_stack;     // exception handler stack
     lstack_t *eval_stack;   // evaluation stack
+    lstack_t *wind_stack;   // dynamic-wind (before . after) thunks
+    lisp_engine_t engine;   // execution engine
+
+    /* continuations, see p_call_cc */
+    lcont_t *conts;         // call/cc's entered, innermost first
+    char *stack_base;       // C stack above the top-level form
+
+    /* pending tail call, see lisp_tail_call */
+    lnode_t *tc_node;       // node to continue with
+    lv_t *tc_fn;            // function being entered, or NULL
+    lv_t *tc_args;          // arguments for tc_fn
+
+    /* frames of calls that never escape */
+    lregion_t region;
+
+    /* lookup cache counters */
+    long ic_hits;
+    long ic_misses;
 
     /* is this really necessary? */
     lisp_exception_t exc;   // current exception
@@ -108,26 +152,45 @@ typedef struct lexec_t {
 } lexec_t;
 
 typedef lv_t *(*lisp_method_t)(lexec_t *, lv_t*);
+typedef lv_t *(*lisp_argv_method_t)(lexec_t *, int, lv_t **);
 
 typedef struct port_info_t port_info_t;  /* ports.c */
 
 #define L_CHAR(what)    (what)->value.ch.value
-#define L_INT(what)     (what)->value.i.value
+#define L_INT(what)     (what)->value.i.v.big    // bignums only
+#define L_FIX(what)     (what)->value.i.v.fix    // fixnums only
+#define L_INT_BIG(what) (what)->value.i.big
 #define L_RAT(what)     (what)->value.r.value
 #define L_FLOAT(what)   (what)->value.f.value
+#define L_BIGFLOAT(what) (what)->value.bf.value
 #define L_BOOL(what)    (what)->value.b.value
 #define L_SYM(what)     (what)->value.s.value
+#define L_SYM_FORM(what) (what)->value.s.form
 #define L_STR(what)     (what)->value.c.value
 #define L_CDR(what)     (what)->value.p.cdr
 #define L_CAR(what)     (what)->value.p.car
 #define L_HASH(what)    (what)->value.h.value
+#define L_FRAME_SCOPE(what)     (what)->value.fr.scope
+#define L_FRAME_COUNT(what)     (what)->value.fr.count
+#define L_FRAME_EXTRA(what)     (what)->value.fr.extra
+#define L_FRAME_SLOTS(what)     (what)->value.fr.slots
+#define L_FRAME_SLOT(what, i)   (what)->value.fr.slots[i]
 #define L_ERR(what)     (what)->value.e.value
 
 #define L_FN(what)      (what)->value.l.fn
+#define L_FN_ARGV(what) (what)->value.l.argv_fn
 #define L_FN_FTYPE(what) (what)->value.l.ftype
+#define L_FN_MIN_ARGS(what) (what)->value.l.min_args
+#define L_FN_MAX_ARGS(what) (what)->value.l.max_args
 #define L_FN_ARGS(what) (what)->value.l.formals
 #define L_FN_BODY(what) (what)->value.l.body
 #define L_FN_ENV(what)  (what)->value.l.env
+#define L_FN_CODE(what) (what)->value.l.code
+#define L_FN_SCOPE(what) (what)->value.l.scope
+#define L_FN_DYNAMIC(what) (what)->value.l.dynamic
+#define L_FN_PURE(what) (what)->value.l.pure
+#define L_FN_DATA(what) (what)->value.l.data
+#define L_FN_BOUND(what) (what)->value.l.bound
 
 #define L_PORT(what)    (what)->value.port.pi
 
@@ -143,8 +206,16 @@ typedef struct lisp_char_t {
     char value;
 } lisp_char_t;
 
+/**
+ * an int is a fixnum while it fits in an int64_t, and an mpz
+ * bignum only when it doesn't, see lisp_int_normalize
+ */
 typedef struct lisp_int_t {
-    mpz_t value;
+    int big;            // value is in v.big rather than v.fix
+    union {
+        int64_t fix;
+        mpz_t big;
+    } v;
 } lisp_int_t;
 
 typedef struct lisp_rational_t {
@@ -152,15 +223,24 @@ typedef struct lisp_rational_t {
 } lisp_rational_t;
 
 typedef struct lisp_float_t {
-    mpfr_t value;
+    double value;
 } lisp_float_t;
 
+/**
+ * mpfr float with its own precision, only made on request (see
+ * p_bigfloat).  Plain floats are doubles.
+ */
+typedef struct lisp_bigfloat_t {
+    mpfr_t value;
+} lisp_bigfloat_t;
+
 typedef struct lisp_bool_t {
     int value;
 } lisp_bool_t;
 
 typedef struct lisp_symbol_t {
     char *value;
+    int form;           // special form named, or 0 (see analyze.h)
 } lisp_symbol_t;
 
 typedef struct lisp_string_t {
@@ -177,6 +257,18 @@ typedef struct lisp_hash_t {
     lisp_type_t index_type;
 } lisp_hash_t;
 
+/**
+ * an activation frame: one slot per name bound by a lambda
+ * or let, in the order of the static scope.  Names defined at
+ * runtime that the scope does not know about go in extra.
+ */
+typedef struct lisp_frame_t {
+    lscope_t *scope;
+    int count;
+    lv_t *extra;
+    lv_t **slots;
+} lisp_frame_t;
+
 typedef struct lisp_null_t {
 } lisp_null_t;
 
@@ -186,38 +278,56 @@ typedef struct lisp_err_t {
 
 typedef struct lisp_fn_t {
     lisp_method_t fn;
+    lisp_argv_method_t argv_fn;  // native taking an argument vector
     lisp_funtype_t ftype;
+    int min_args;       // arity, checked when the function is called
+    int max_args;       // or LISP_ARGS_ANY
     lv_t *formals;
     lv_t *body;
     lv_t *env;
+    lnode_t *code;      // analyzed body, filled in lazily
+    lscope_t *scope;    // frame layout for calls, with code
+    int dynamic;        // macro expanded on every use, not once per site
+    int pure;           // native with no side effects, folded when
+                        // called on constants
+    void *data;         // state of a native made at runtime
+    lv_t *bound;        // symbol first defined to this, or NULL
 } lisp_fn_t;
 
 typedef struct lisp_port_t {
     port_info_t *pi;
 } lisp_port_t;
 
+/**
+ * a value is its type and the payload for that type.  Cells are
+ * allocated only as big as their own payload (LV_SIZE), so a pair
+ * is the type word and two pointers.  Source positions live in a
+ * side table, see lisp_stamp_value.
+ */
 typedef struct lv_t {
     lisp_type_t type;
-    int col;
-    int row;
-    lv_t *bound;
-    char *file;
     union {
         lisp_char_t ch;
         lisp_int_t i;
         lisp_rational_t r;
         lisp_float_t f;
+        lisp_bigfloat_t bf;
         lisp_bool_t b;
         lisp_symbol_t s;
         lisp_string_t c;
         lisp_pair_t p;
         lisp_hash_t h;
+        lisp_frame_t fr;
         lisp_fn_t l;
         lisp_err_t e;
         lisp_port_t port;
     } value;
 } lv_t;
 
+/* bytes in a cell whose payload is value.member */
+#define LV_SIZE(member) \
+    (offsetof(lv_t, value) + sizeof(((lv_t *)0)->value.member))
+
 /** given a native c type, box it into a lisp type struct */
 extern lv_t *lisp_create_type(void *value, lisp_type_t type);
 
@@ -37,8 +37,6 @@ lv_t *p_append(lexec_t *exec, lv_t *v) {
     assert(exec && v);
     assert((v->type == l_pair) || (v->type == l_null));
 
-    rt_assert(c_list_length(v) > 1, le_arity, "expecting at least 1 arg");
-
     r = L_CAR(v);
     vptr = L_CDR(v);
 
@@ -80,8 +78,6 @@ lv_t *p_reverse(lexec_t *exec, lv_t *v) {
     assert(exec && v);
     assert((v->type == l_pair) || (v->type == l_null));
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 arg");
-
     vptr = L_CAR(v);
     if(vptr->type == l_null)
         return lisp_create_null();
@@ -111,15 +107,13 @@ lv_t *p_list_tail(lexec_t *exec, lv_t *v) {
     assert(exec && v);
     assert((v->type == l_pair) || (v->type == l_null));
 
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 args");
-
     a0 = L_CAR(v);
     a1 = L_CADR(v);
 
     rt_assert(a0->type == l_pair, le_type, "expecting list as arg0");
     rt_assert(a1->type == l_int, le_type, "expecting int as arg1");
 
-    k = mpz_get_si(L_INT(a1));
+    k = lisp_int_get(a1);
 
     r = lisp_get_kth(a0, k);
 
@@ -141,15 +135,13 @@ lv_t *p_list_ref(lexec_t *exec, lv_t *v) {
     assert(exec && v);
     assert((v->type == l_pair) || (v->type == l_null));
 
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 args");
-
     a0 = L_CAR(v);
     a1 = L_CADR(v);
 
     rt_assert(a0->type == l_pair, le_type, "expecting list as arg0");
     rt_assert(a1->type == l_int, le_type, "expecting int as arg1");
 
-    k = mpz_get_si(L_INT(a1));
+    k = lisp_int_get(a1);
 
     r = lisp_get_kth(a0, k);
 
@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <setjmp.h>
@@ -30,6 +31,7 @@
 #include "primitives.h"
 #include "ports.h"
 #include "parser.h"
+#include "aot.h"
 
 static int is_nil(lv_t *v) {
     return(v && v->type == l_null);
@@ -39,11 +41,14 @@ void usage(char *a0) {
     printf("Usage: %s [options]\n\n", a0);
     printf("Valid options\n");
     printf(" -h           this help page\n");
+    printf(" -e <engine>  evaluate with engine 'tree' or 'vm'\n");
+    printf(" -c <file>    compile a program to C, linked with libminischeme\n");
+    printf(" -o <file>    where -c writes the C (default stdout)\n");
 
     printf("\n\n");
 }
 
-void repl(int level) {
+void repl(int level, lisp_engine_t engine) {
     char prompt[30];
     char *cmd;
     int quit = 0;
@@ -57,6 +62,7 @@ void repl(int level) {
     lexec_t *exec;
 
     exec = lisp_context_new(5); /* get r5rs environment */
+    lisp_set_engine(exec, engine);
 
     while(!quit) {
         snprintf(prompt, sizeof(prompt), "%d:%d> ", level, line);
@@ -111,21 +117,74 @@ void repl(int level) {
     }
 }
 
+/**
+ * compile the program in infile to C, in outfile
+ */
+int compile(char *infile, char *outfile) {
+    lexec_t *exec;
+    lv_t *forms;
+    FILE *out = stdout;
+    int result;
+
+    exec = lisp_context_new(5);
+    forms = c_parse_file(exec, infile);
+
+    if(outfile && !(out = fopen(outfile, "w"))) {
+        perror(outfile);
+        return 0;
+    }
+
+    result = lisp_aot_compile(exec, forms, infile, out);
+
+    if(out != stdout && fclose(out)) {
+        perror(outfile);
+        return 0;
+    }
+
+    if(!result && outfile)
+        unlink(outfile);
+
+    return result;
+}
+
 int main(int argc, char *argv[]) {
     int option;
     char *infile = NULL;
+    char *cfile = NULL;
+    char *outfile = NULL;
+    lisp_engine_t engine = en_tree;
 
-    while((option = getopt(argc, argv, "f:h")) != -1) {
+    while((option = getopt(argc, argv, "c:e:f:ho:")) != -1) {
         switch(option) {
         case 'h':
             usage(argv[0]);
             exit(EXIT_SUCCESS);
             break;
 
+        case 'e':
+            if(!strcmp(optarg, "tree")) {
+                engine = en_tree;
+            } else if(!strcmp(optarg, "vm")) {
+                engine = en_vm;
+            } else {
+                fprintf(stderr, "Unknown engine: '%s'\n", optarg);
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
         case 'f':
             infile = optarg;
             break;
 
+        case 'c':
+            cfile = optarg;
+            break;
+
+        case 'o':
+            outfile = optarg;
+            break;
+
         default:
             fprintf(stderr, "Unknown argument: '%c'\n", option);
             usage(argv[0]);
@@ -134,11 +193,14 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if(cfile)
+        exit(compile(cfile, outfile) ? EXIT_SUCCESS : EXIT_FAILURE);
+
     if(infile) {
         // load the file and execute it.
-        repl(0);
+        repl(0, engine);
     } else {
-        repl(0);
+        repl(0, engine);
     }
 
     exit(EXIT_SUCCESS);
@@ -27,6 +27,8 @@
 #include "primitives.h"
 #include "math.h"
 
+/* our math.h shadows the system one, so libm goes by the builtins */
+
 typedef enum math_comp_t { MC_EQ, MC_GT, MC_LT, MC_GTE, MC_LTE } math_comp_t;
 typedef enum math_op_t { MO_ADD, MO_SUB, MO_MUL, MO_DIV } math_op_t;
 typedef enum math_round_t { MR_FLOOR, MR_CEIL, MR_TRUNC, MR_ROUND } math_round_t;
@@ -34,53 +36,104 @@ typedef enum math_trig_t { MT_SIN, MT_COS, MT_TAN,
                            MT_ASIN, MT_ACOS, MT_ATAN
 } math_trig_t;
 
-static void math_promote(lv_t **a, lisp_type_t what) {
-    lv_t *new_val;
+/**
+ * a number as a double, rounded to nearest
+ */
+static double math_get_d(lv_t *v) {
+    mpfr_t tmp;
+    double d;
 
-    assert(a && *a);
-    assert((*a)->type <= what);
+    switch(v->type) {
+    case l_int:
+        if(!L_INT_BIG(v))
+            return (double)L_FIX(v);
+        mpfr_init2(tmp, 53);
+        mpfr_set_z(tmp, L_INT(v), MPFR_ROUND_TYPE);
+        break;
+    case l_rational:
+        mpfr_init2(tmp, 53);
+        mpfr_set_q(tmp, L_RAT(v), MPFR_ROUND_TYPE);
+        break;
+    case l_float:
+        return L_FLOAT(v);
+    case l_bigfloat:
+        return mpfr_get_d(L_BIGFLOAT(v), MPFR_ROUND_TYPE);
+    default:
+        assert(0);
+    }
 
-    switch((*a)->type) {
+    d = mpfr_get_d(tmp, MPFR_ROUND_TYPE);
+    mpfr_clear(tmp);
+    return d;
+}
+
+/**
+ * set an mpfr from any number, at the mpfr's own precision
+ */
+static void math_set_mpfr(mpfr_t r, lv_t *v) {
+    mpz_t tmp;
+
+    switch(v->type) {
     case l_int:
-        switch(what) {
-        case l_int:
-            break;
-        case l_rational:
-            new_val = lisp_create_rational(1, 1);
-            mpq_set_z(L_RAT(new_val), L_INT(*a));
-            *a = new_val;
-            break;
-        case l_float:
-            new_val = lisp_create_float(0);
-            mpfr_set_z(L_FLOAT(new_val), L_INT(*a), MPFR_ROUND_TYPE);
-            *a = new_val;
-            break;
-        default:
-            assert(0);
-        }
+        mpfr_set_z(r, lisp_int_mpz(v, tmp), MPFR_ROUND_TYPE);
         break;
     case l_rational:
-        switch(what) {
-        case l_rational:
-            break;
-        case l_float:
-            new_val = lisp_create_float(0);
-            mpfr_set_q(L_FLOAT(new_val), L_RAT(*a), MPFR_ROUND_TYPE);
-            *a = new_val;
-            break;
-        default:
-            assert(0);
-        }
+        mpfr_set_q(r, L_RAT(v), MPFR_ROUND_TYPE);
         break;
     case l_float:
-        if(what == l_float)
-            break;
+        mpfr_set_d(r, L_FLOAT(v), MPFR_ROUND_TYPE);
+        break;
+    case l_bigfloat:
+        mpfr_set(r, L_BIGFLOAT(v), MPFR_ROUND_TYPE);
+        break;
+    default:
         assert(0);
+    }
+}
+
+/**
+ * promote *a up the tower to type what: int, rational, float
+ * (a double), then bigfloat, which is made with prec bits.
+ * Floats only become bigfloats next to one, so plain float
+ * arithmetic never touches mpfr.
+ */
+static void math_promote(lv_t **a, lisp_type_t what, mpfr_prec_t prec) {
+    lv_t *new_val;
+    mpz_t tmp;
+
+    assert(a && *a);
+    assert((*a)->type <= what);
+
+    if((*a)->type == what)
+        return;
+
+    switch(what) {
+    case l_rational:
+        assert((*a)->type == l_int);
+        new_val = lisp_create_rational(1, 1);
+        mpq_set_z(L_RAT(new_val), lisp_int_mpz(*a, tmp));
+        break;
+    case l_float:
+        new_val = lisp_create_float(math_get_d(*a));
+        break;
+    case l_bigfloat:
+        new_val = lisp_create_bigfloat(prec);
+        math_set_mpfr(L_BIGFLOAT(new_val), *a);
+        break;
     default:
         assert(0);
     }
 
-    return;
+    *a = new_val;
+}
+
+/**
+ * precision of v if it is a bigfloat, else 0
+ */
+static mpfr_prec_t math_prec(lv_t *v) {
+    if(v->type == l_bigfloat)
+        return mpfr_get_prec(L_BIGFLOAT(v));
+    return 0;
 }
 
 static void math_maybe_promote(lv_t **a0, lv_t **a1) {
@@ -91,16 +144,17 @@ static void math_maybe_promote(lv_t **a0, lv_t **a1) {
         return;
 
     if((*a0)->type > (*a1)->type) {
-        math_promote(a1, (*a0)->type);
+        math_promote(a1, (*a0)->type, math_prec(*a0));
     } else {
-        math_promote(a0, (*a1)->type);
+        math_promote(a0, (*a1)->type, math_prec(*a1));
     }
 }
 
 static int math_numeric(lv_t *v) {
     return (v->type == l_int ||
             v->type == l_rational ||
-            v->type == l_float);
+            v->type == l_float ||
+            v->type == l_bigfloat);
 
 }
 
@@ -111,16 +165,15 @@ static lv_t *math_copy_value(lv_t *v) {
 
     switch(v->type) {
     case l_int:
-        pnew = lisp_create_int(0);
-        mpz_set(L_INT(pnew), L_INT(v));
+        pnew = lisp_dup_item(v);
         break;
     case l_rational:
         pnew = lisp_create_rational(0, 0);
         mpq_set(L_RAT(pnew), L_RAT(v));
         break;
     case l_float:
-        pnew = lisp_create_float(0);
-        mpfr_set(L_FLOAT(pnew), L_FLOAT(pnew), MPFR_ROUND_TYPE);
+    case l_bigfloat:
+        pnew = lisp_dup_item(v);
         break;
     default:
         assert(0);
@@ -129,13 +182,66 @@ static lv_t *math_copy_value(lv_t *v) {
     return pnew;
 }
 
+/**
+ * turn a fixnum into a bignum, in place.  Only for values that
+ * nothing else holds yet, like an accumulator.
+ */
+static void math_int_big(lv_t *v) {
+    int64_t fix;
+
+    if(L_INT_BIG(v))
+        return;
+
+    fix = L_FIX(v);
+    L_INT_BIG(v) = 1;
+    mpz_init_set_si(L_INT(v), fix);
+}
+
+/**
+ * a op= b on two fixnums.  Returns 0, leaving a alone, if either
+ * is a bignum or the result doesn't fit a fixnum.
+ */
+static int math_fix_op(math_op_t op, lv_t *a, lv_t *b) {
+    int64_t x, y, r;
+
+    if(L_INT_BIG(a) || L_INT_BIG(b))
+        return 0;
+
+    x = L_FIX(a);
+    y = L_FIX(b);
+
+    switch(op) {
+    case MO_ADD:
+        if(__builtin_add_overflow(x, y, &r))
+            return 0;
+        break;
+    case MO_SUB:
+        if(__builtin_sub_overflow(x, y, &r))
+            return 0;
+        break;
+    case MO_MUL:
+        if(__builtin_mul_overflow(x, y, &r))
+            return 0;
+        break;
+    case MO_DIV:
+        /* inexact quotients go rational */
+        if(y == 0 || (x == INT64_MIN && y == -1) || x % y)
+            return 0;
+        r = x / y;
+        break;
+    default:
+        assert(0);
+    }
+
+    L_FIX(a) = r;
+    return 1;
+}
 
 /**
  * is the value in question an integer?
  */
 lv_t *p_integerp(lexec_t *exec, lv_t *v) {
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
     return lisp_create_bool(a0->type == l_int);
@@ -146,7 +252,6 @@ lv_t *p_integerp(lexec_t *exec, lv_t *v) {
  */
 lv_t *p_rationalp(lexec_t *exec, lv_t *v) {
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
     return lisp_create_bool(a0->type == l_rational);
@@ -157,10 +262,9 @@ lv_t *p_rationalp(lexec_t *exec, lv_t *v) {
  */
 lv_t *p_floatp(lexec_t *exec, lv_t *v) {
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
-    return lisp_create_bool(a0->type == l_float);
+    return lisp_create_bool(a0->type == l_float || a0->type == l_bigfloat);
 }
 
 /**
@@ -170,7 +274,6 @@ lv_t *p_exactp(lexec_t *exec, lv_t *v) {
     int res = 1;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
 
@@ -179,6 +282,7 @@ lv_t *p_exactp(lexec_t *exec, lv_t *v) {
     case l_rational:
         break;
     case l_float:
+    case l_bigfloat:
         res  = 0;
         break;
     default:
@@ -195,7 +299,6 @@ lv_t *p_inexactp(lexec_t *exec, lv_t *v) {
     int res = 0;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
 
@@ -204,6 +307,7 @@ lv_t *p_inexactp(lexec_t *exec, lv_t *v) {
     case l_rational:
         break;
     case l_float:
+    case l_bigfloat:
         res = 1;
         break;
     default:
@@ -214,17 +318,37 @@ lv_t *p_inexactp(lexec_t *exec, lv_t *v) {
 }
 
 /**
- * compare two numeric types
+ * (bigfloat x bits): x as an mpfr float of the given precision
  */
-static lv_t *comp_op(lexec_t *exec, lv_t *v, math_comp_t op) {
-    int result;
+lv_t *p_bigfloat(lexec_t *exec, lv_t *v) {
+    lv_t *result;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 arguments");
 
     lv_t *a0 = L_CAR(v);
     lv_t *a1 = L_CADR(v);
 
+    rt_assert(math_numeric(a0), le_type, "expecting numeric argument");
+    rt_assert(a1->type == l_int && !L_INT_BIG(a1) &&
+              L_FIX(a1) >= MPFR_PREC_MIN && L_FIX(a1) <= MPFR_PREC_MAX,
+              le_type, "expecting a precision in bits");
+
+    result = lisp_create_bigfloat((mpfr_prec_t)L_FIX(a1));
+    math_set_mpfr(L_BIGFLOAT(result), a0);
+    return result;
+}
+
+/**
+ * compare two numeric types
+ */
+static lv_t *comp_op(lexec_t *exec, int argc, lv_t **argv, math_comp_t op) {
+    int result;
+
+    assert(exec);
+
+    lv_t *a0 = argv[0];
+    lv_t *a1 = argv[1];
+
     rt_assert(math_numeric(a0),
               le_type, "expecting numeric arguments");
 
@@ -238,19 +362,19 @@ static lv_t *comp_op(lexec_t *exec, lv_t *v, math_comp_t op) {
     case l_int:
         switch(op) {
         case MC_EQ:
-            result = (mpz_cmp(L_INT(a0), L_INT(a1)) == 0);
+            result = (lisp_int_cmp(a0, a1) == 0);
             break;
         case MC_GT:
-            result = (mpz_cmp(L_INT(a0), L_INT(a1)) > 0);
+            result = (lisp_int_cmp(a0, a1) > 0);
             break;
         case MC_LT:
-            result = (mpz_cmp(L_INT(a0), L_INT(a1)) < 0);
+            result = (lisp_int_cmp(a0, a1) < 0);
             break;
         case MC_GTE:
-            result = (mpz_cmp(L_INT(a0), L_INT(a1)) >= 0);
+            result = (lisp_int_cmp(a0, a1) >= 0);
             break;
         case MC_LTE:
-            result = (mpz_cmp(L_INT(a0), L_INT(a1)) <= 0);
+            result = (lisp_int_cmp(a0, a1) <= 0);
             break;
         default:
             assert(0);
@@ -280,19 +404,40 @@ static lv_t *comp_op(lexec_t *exec, lv_t *v, math_comp_t op) {
     case l_float:
         switch(op) {
         case MC_EQ:
-            result = mpfr_cmp(L_FLOAT(a0), L_FLOAT(a1)) == 0;
+            result = L_FLOAT(a0) == L_FLOAT(a1);
             break;
         case MC_GT:
-            result = mpfr_cmp(L_FLOAT(a0), L_FLOAT(a1)) > 0;
+            result = L_FLOAT(a0) > L_FLOAT(a1);
             break;
         case MC_LT:
-            result = mpfr_cmp(L_FLOAT(a0), L_FLOAT(a1)) < 0;
+            result = L_FLOAT(a0) < L_FLOAT(a1);
             break;
         case MC_GTE:
-            result = mpfr_cmp(L_FLOAT(a0), L_FLOAT(a1)) >= 0;
+            result = L_FLOAT(a0) >= L_FLOAT(a1);
             break;
         case MC_LTE:
-            result = mpfr_cmp(L_FLOAT(a0), L_FLOAT(a1)) <= 0;
+            result = L_FLOAT(a0) <= L_FLOAT(a1);
+            break;
+        default:
+            assert(0);
+        }
+        break;
+    case l_bigfloat:
+        switch(op) {
+        case MC_EQ:
+            result = mpfr_equal_p(L_BIGFLOAT(a0), L_BIGFLOAT(a1));
+            break;
+        case MC_GT:
+            result = mpfr_greater_p(L_BIGFLOAT(a0), L_BIGFLOAT(a1));
+            break;
+        case MC_LT:
+            result = mpfr_less_p(L_BIGFLOAT(a0), L_BIGFLOAT(a1));
+            break;
+        case MC_GTE:
+            result = mpfr_greaterequal_p(L_BIGFLOAT(a0), L_BIGFLOAT(a1));
+            break;
+        case MC_LTE:
+            result = mpfr_lessequal_p(L_BIGFLOAT(a0), L_BIGFLOAT(a1));
             break;
         default:
             assert(0);
@@ -306,39 +451,37 @@ static lv_t *comp_op(lexec_t *exec, lv_t *v, math_comp_t op) {
 }
 
 
-lv_t *p_gt(lexec_t *exec, lv_t *v) {
-    return comp_op(exec, v, MC_GT);
+lv_t *p_gt(lexec_t *exec, int argc, lv_t **argv) {
+    return comp_op(exec, argc, argv, MC_GT);
 }
 
-lv_t *p_lt(lexec_t *exec, lv_t *v) {
-    return comp_op(exec, v, MC_LT);
+lv_t *p_lt(lexec_t *exec, int argc, lv_t **argv) {
+    return comp_op(exec, argc, argv, MC_LT);
 }
 
-lv_t *p_gte(lexec_t *exec, lv_t *v) {
-    return comp_op(exec, v, MC_GTE);
+lv_t *p_gte(lexec_t *exec, int argc, lv_t **argv) {
+    return comp_op(exec, argc, argv, MC_GTE);
 }
 
-lv_t *p_lte(lexec_t *exec, lv_t *v) {
-    return comp_op(exec, v, MC_LTE);
+lv_t *p_lte(lexec_t *exec, int argc, lv_t **argv) {
+    return comp_op(exec, argc, argv, MC_LTE);
 }
 
-lv_t *p_eq(lexec_t *exec, lv_t *v) {
-    return comp_op(exec, v, MC_EQ);
+lv_t *p_eq(lexec_t *exec, int argc, lv_t **argv) {
+    return comp_op(exec, argc, argv, MC_EQ);
 }
 
 /**
  * perform a rolling accumulated function
  */
-static lv_t *accum_op(lexec_t *exec, lv_t *v, math_op_t op) {
+static lv_t *accum_op(lexec_t *exec, int argc, lv_t **argv, math_op_t op) {
     lv_t *a;
-    lv_t *current;
     lv_t *arg;
+    mpz_t tmp;
+    mpz_ptr z;
+    int index = 0;
 
     assert(exec);
-    assert(v && (v->type == l_pair || v->type == l_null));
-
-    if(op == MO_SUB || op == MO_DIV)
-        rt_assert(c_list_length(v) >= 1, le_arity, "expecting more arguments");
 
     switch(op) {
     case MO_MUL:
@@ -355,25 +498,17 @@ static lv_t *accum_op(lexec_t *exec, lv_t *v, math_op_t op) {
         assert(0);
     }
 
-    if(c_list_length(v) == 0)
-        return a;
+    if((op == MO_DIV || op == MO_SUB) && argc > 1) {
+        /* seed accumulator with first argument */
+        rt_assert(math_numeric(argv[0]), le_type, "expecting numeric");
 
-    current = v;
-
-    if((op == MO_DIV || op == MO_SUB) && c_list_length(v) > 1) {
-        /* seed accumulator with first item in list */
-        rt_assert(math_numeric(L_CAR(current)), le_type, "expecting numeric");
-
-        a = math_copy_value(L_CAR(current));
-        current = L_CDR(current);
-
-        assert(current);
-        rt_assert(current->type == l_pair, le_type, "expecting proper list");
+        a = math_copy_value(argv[0]);
+        index++;
     }
 
     /* we have accumulator, walk through all the params */
-    while(current && L_CAR(current)) {
-        arg = L_CAR(current);
+    for(; index < argc; index++) {
+        arg = argv[index];
 
         rt_assert(math_numeric(arg), le_type, "expecting numeric");
 
@@ -382,27 +517,34 @@ static lv_t *accum_op(lexec_t *exec, lv_t *v, math_op_t op) {
 
         switch(arg->type) {
         case l_int:
+            /* fixnums, unless they overflow */
+            if(math_fix_op(op, a, arg))
+                break;
+
+            math_int_big(a);
+            z = lisp_int_mpz(arg, tmp);
+
             switch(op) {
             case MO_ADD:
-                mpz_add(L_INT(a), L_INT(a), L_INT(arg));
+                mpz_add(L_INT(a), L_INT(a), z);
                 break;
             case MO_SUB:
-                mpz_sub(L_INT(a), L_INT(a), L_INT(arg));
+                mpz_sub(L_INT(a), L_INT(a), z);
                 break;
             case MO_MUL:
-                mpz_mul(L_INT(a), L_INT(a), L_INT(arg));
+                mpz_mul(L_INT(a), L_INT(a), z);
                 break;
             case MO_DIV:
-                rt_assert(mpz_cmp_ui(L_INT(arg), 0) != 0, le_div,
+                rt_assert(mpz_cmp_ui(z, 0) != 0, le_div,
                           "attempt to divide by zero");
                 /* should we promote? */
-                if(!mpz_divisible_p(L_INT(a), L_INT(arg))) {
+                if(!mpz_divisible_p(L_INT(a), z)) {
                     /* yes! we must promote! */
-                    math_promote(&a, l_rational);
-                    math_promote(&arg, l_rational);
+                    math_promote(&a, l_rational, 0);
+                    math_promote(&arg, l_rational, 0);
                     mpq_div(L_RAT(a), L_RAT(a), L_RAT(arg));
                 } else {
-                    mpz_tdiv_q(L_INT(a), L_INT(a), L_INT(arg));
+                    mpz_tdiv_q(L_INT(a), L_INT(a), z);
                 }
                 break;
             default:
@@ -430,16 +572,43 @@ static lv_t *accum_op(lexec_t *exec, lv_t *v, math_op_t op) {
         case l_float:
             switch(op) {
             case MO_ADD:
-                mpfr_add(L_FLOAT(a), L_FLOAT(a), L_FLOAT(arg), MPFR_ROUND_TYPE);
+                L_FLOAT(a) += L_FLOAT(arg);
                 break;
             case MO_SUB:
-                mpfr_sub(L_FLOAT(a), L_FLOAT(a), L_FLOAT(arg), MPFR_ROUND_TYPE);
+                L_FLOAT(a) -= L_FLOAT(arg);
                 break;
             case MO_MUL:
-                mpfr_mul(L_FLOAT(a), L_FLOAT(a), L_FLOAT(arg), MPFR_ROUND_TYPE);
+                L_FLOAT(a) *= L_FLOAT(arg);
                 break;
             case MO_DIV:
-                mpfr_div(L_FLOAT(a), L_FLOAT(a), L_FLOAT(arg), MPFR_ROUND_TYPE);
+                L_FLOAT(a) /= L_FLOAT(arg);
+                break;
+            default:
+                assert(0);
+            }
+            break;
+        case l_bigfloat:
+            /* the result keeps the wider precision */
+            if(mpfr_get_prec(L_BIGFLOAT(arg)) > mpfr_get_prec(L_BIGFLOAT(a)))
+                mpfr_prec_round(L_BIGFLOAT(a), mpfr_get_prec(L_BIGFLOAT(arg)),
+                                MPFR_ROUND_TYPE);
+
+            switch(op) {
+            case MO_ADD:
+                mpfr_add(L_BIGFLOAT(a), L_BIGFLOAT(a), L_BIGFLOAT(arg),
+                         MPFR_ROUND_TYPE);
+                break;
+            case MO_SUB:
+                mpfr_sub(L_BIGFLOAT(a), L_BIGFLOAT(a), L_BIGFLOAT(arg),
+                         MPFR_ROUND_TYPE);
+                break;
+            case MO_MUL:
+                mpfr_mul(L_BIGFLOAT(a), L_BIGFLOAT(a), L_BIGFLOAT(arg),
+                         MPFR_ROUND_TYPE);
+                break;
+            case MO_DIV:
+                mpfr_div(L_BIGFLOAT(a), L_BIGFLOAT(a), L_BIGFLOAT(arg),
+                         MPFR_ROUND_TYPE);
                 break;
             default:
                 assert(0);
@@ -448,52 +617,64 @@ static lv_t *accum_op(lexec_t *exec, lv_t *v, math_op_t op) {
         default:
             assert(0);
         }
-
-        current = L_CDR(current);
-        if(current)
-            rt_assert(current->type == l_pair, le_type, "expecting proper list");
     }
 
+    if(a->type == l_int)
+        lisp_int_normalize(a);
+
     return a;
 }
 
 
-lv_t *p_plus(lexec_t *exec, lv_t *v) {
-    return accum_op(exec, v, MO_ADD);
+lv_t *p_plus(lexec_t *exec, int argc, lv_t **argv) {
+    return accum_op(exec, argc, argv, MO_ADD);
 }
 
-lv_t *p_minus(lexec_t *exec, lv_t *v) {
-    return accum_op(exec, v, MO_SUB);
+lv_t *p_minus(lexec_t *exec, int argc, lv_t **argv) {
+    return accum_op(exec, argc, argv, MO_SUB);
 }
 
-lv_t *p_mul(lexec_t *exec, lv_t *v) {
-    return accum_op(exec, v, MO_MUL);
+lv_t *p_mul(lexec_t *exec, int argc, lv_t **argv) {
+    return accum_op(exec, argc, argv, MO_MUL);
 }
 
-lv_t *p_div(lexec_t *exec, lv_t *v) {
-    return accum_op(exec, v, MO_DIV);
+lv_t *p_div(lexec_t *exec, int argc, lv_t **argv) {
+    return accum_op(exec, argc, argv, MO_DIV);
 }
 
 
+/**
+ * can n/m be done on fixnums?  The one quotient of two that
+ * doesn't fit is INT64_MIN / -1.
+ */
+static int math_fix_div(lv_t *n, lv_t *m) {
+    return !L_INT_BIG(n) && !L_INT_BIG(m) && L_FIX(m) &&
+        !(L_FIX(n) == INT64_MIN && L_FIX(m) == -1);
+}
+
 /**
  * integer quotient of n/m
  */
 lv_t *p_quotient(lexec_t *exec, lv_t *v) {
     lv_t *result;
     lv_t *ir;
+    mpz_t t0, t1;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 arguments");
 
     lv_t *a0 = L_CAR(v);
     lv_t *a1 = L_CADR(v);
 
     rt_assert(a0->type == l_int, le_type, "expecting integer arguments");
     rt_assert(a1->type == l_int, le_type, "expecting integer arguments");
+    rt_assert(lisp_int_sgn(a1), le_div, "attempt to divide by zero");
 
-    result = lisp_create_int(0);
-    mpz_tdiv_q(L_INT(result), L_INT(a0), L_INT(a1));
-    return result;
+    if(math_fix_div(a0, a1))
+        return lisp_create_int(L_FIX(a0) / L_FIX(a1));
+
+    result = lisp_create_bigint();
+    mpz_tdiv_q(L_INT(result), lisp_int_mpz(a0, t0), lisp_int_mpz(a1, t1));
+    return lisp_int_normalize(result);
 }
 
 /**
@@ -502,19 +683,23 @@ lv_t *p_quotient(lexec_t *exec, lv_t *v) {
 lv_t *p_remainder(lexec_t *exec, lv_t *v) {
     lv_t *result;
     lv_t *ir;
+    mpz_t t0, t1;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 arguments");
 
     lv_t *a0 = L_CAR(v);
     lv_t *a1 = L_CADR(v);
 
     rt_assert(a0->type == l_int, le_type, "expecting integer arguments");
     rt_assert(a1->type == l_int, le_type, "expecting integer arguments");
+    rt_assert(lisp_int_sgn(a1), le_div, "attempt to divide by zero");
 
-    result = lisp_create_int(0);
-    mpz_tdiv_r(L_INT(result), L_INT(a0), L_INT(a1));
-    return result;
+    if(math_fix_div(a0, a1))
+        return lisp_create_int(L_FIX(a0) % L_FIX(a1));
+
+    result = lisp_create_bigint();
+    mpz_tdiv_r(L_INT(result), lisp_int_mpz(a0, t0), lisp_int_mpz(a1, t1));
+    return lisp_int_normalize(result);
 }
 
 /**
@@ -534,55 +719,96 @@ void mpz_scheme_mod(mpz_t r, const mpz_t n, const mpz_t d) {
 lv_t *p_modulo(lexec_t *exec, lv_t *v) {
     lv_t *result;
     lv_t *ir;
+    mpz_t t0, t1;
+    int64_t r;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 2, le_arity, "expecting 2 arguments");
 
     lv_t *a0 = L_CAR(v);
     lv_t *a1 = L_CADR(v);
 
     rt_assert(a0->type == l_int, le_type, "expecting integer arguments");
     rt_assert(a1->type == l_int, le_type, "expecting integer arguments");
+    rt_assert(lisp_int_sgn(a1), le_div, "attempt to divide by zero");
+
+    if(math_fix_div(a0, a1)) {
+        /* the result takes the sign of the divisor */
+        r = L_FIX(a0) % L_FIX(a1);
+        if(r && (r < 0) != (L_FIX(a1) < 0))
+            r += L_FIX(a1);
+        return lisp_create_int(r);
+    }
 
-    result = lisp_create_int(0);
-    mpz_scheme_mod(L_INT(result), L_INT(a0), L_INT(a1));
-    return result;
+    result = lisp_create_bigint();
+    mpz_scheme_mod(L_INT(result), lisp_int_mpz(a0, t0), lisp_int_mpz(a1, t1));
+    return lisp_int_normalize(result);
 }
 
 static lv_t *round_op(lexec_t *exec, lv_t *v, math_round_t op) {
     lv_t *new_value;
+    mpfr_t r;
+    double d;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
 
     rt_assert(math_numeric(a0),
               le_type, "expecting numeric arguments");
 
-    math_promote(&a0, l_float);
+    if(a0->type == l_int)
+        return a0;
+
+    new_value = lisp_create_bigint();
+
+    if(a0->type == l_bigfloat) {
+        mpfr_init2(r, mpfr_get_prec(L_BIGFLOAT(a0)));
+
+        switch(op) {
+        case MR_FLOOR:
+            mpfr_floor(r, L_BIGFLOAT(a0));
+            break;
+        case MR_CEIL:
+            mpfr_ceil(r, L_BIGFLOAT(a0));
+            break;
+        case MR_ROUND:
+            mpfr_round(r, L_BIGFLOAT(a0));
+            break;
+        case MR_TRUNC:
+            mpfr_trunc(r, L_BIGFLOAT(a0));
+            break;
+        default:
+            assert(0);
+        }
+
+        mpfr_get_z(L_INT(new_value), r, MPFR_ROUND_TYPE);
+        mpfr_clear(r);
+        return lisp_int_normalize(new_value);
+    }
 
-    new_value = lisp_create_int(0);
+    d = math_get_d(a0);
 
     switch(op) {
     case MR_FLOOR:
-        mpfr_floor(L_FLOAT(a0), L_FLOAT(a0));
+        d = __builtin_floor(d);
         break;
     case MR_CEIL:
-        mpfr_ceil(L_FLOAT(a0), L_FLOAT(a0));
+        d = __builtin_ceil(d);
         break;
     case MR_ROUND:
-        mpfr_round(L_FLOAT(a0), L_FLOAT(a0));
+        d = __builtin_round(d);
         break;
     case MR_TRUNC:
-        mpfr_trunc(L_FLOAT(a0), L_FLOAT(a0));
+        d = __builtin_trunc(d);
         break;
     default:
         assert(0);
     }
 
-    mpfr_get_z(L_INT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
-    return new_value;
+    rt_assert(__builtin_isfinite(d), le_type, "expecting a finite number");
+
+    mpz_set_d(L_INT(new_value), d);
+    return lisp_int_normalize(new_value);
 }
 
 lv_t *p_floor(lexec_t *exec, lv_t *v) {
@@ -603,42 +829,70 @@ lv_t *p_round(lexec_t *exec, lv_t *v) {
 
 static lv_t *trig_op(lexec_t *exec, lv_t *v, math_trig_t op) {
     lv_t *new_value;
+    double d;
 
     assert(exec && v && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
 
     rt_assert(math_numeric(a0),
               le_type, "expecting numeric arguments");
 
-    math_promote(&a0, l_float);
-    new_value = lisp_create_float(0);
+    if(a0->type == l_bigfloat) {
+        new_value = lisp_create_bigfloat(mpfr_get_prec(L_BIGFLOAT(a0)));
+
+        switch(op) {
+        case MT_SIN:
+            mpfr_sin(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        case MT_COS:
+            mpfr_cos(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        case MT_TAN:
+            mpfr_tan(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        case MT_ASIN:
+            mpfr_asin(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        case MT_ACOS:
+            mpfr_acos(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        case MT_ATAN:
+            mpfr_atan(L_BIGFLOAT(new_value), L_BIGFLOAT(a0), MPFR_ROUND_TYPE);
+            break;
+        default:
+            assert(0);
+        }
+
+        return new_value;
+    }
+
+    d = math_get_d(a0);
 
     switch(op) {
     case MT_SIN:
-        mpfr_sin(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_sin(d);
         break;
     case MT_COS:
-        mpfr_cos(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_cos(d);
         break;
     case MT_TAN:
-        mpfr_tan(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_tan(d);
         break;
     case MT_ASIN:
-        mpfr_asin(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_asin(d);
         break;
     case MT_ACOS:
-        mpfr_acos(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_acos(d);
         break;
     case MT_ATAN:
-        mpfr_atan(L_FLOAT(new_value), L_FLOAT(a0), MPFR_ROUND_TYPE);
+        d = __builtin_atan(d);
         break;
     default:
         assert(0);
     }
 
-    return new_value;
+    return lisp_create_float(d);
 }
 
 lv_t *p_exp(lexec_t *exec, lv_t *v) {
@@ -680,7 +934,6 @@ lv_t *p_expt(lexec_t *exec, lv_t *v) {
 
 lv_t *p_number2string(lexec_t *exec, lv_t *v) {
     assert(exec && v->type == l_pair);
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
 
     lv_t *a0 = L_CAR(v);
 
@@ -691,3 +944,182 @@ lv_t *p_number2string(lexec_t *exec, lv_t *v) {
 lv_t *p_string2number(lexec_t *exec, lv_t *v) {
 }
 
+/* calls a site is profiled for before it is specialized */
+#define MATH_SITE_WARM 8
+
+/* primitives with specialized paths, and what they do */
+static struct {
+    lisp_argv_method_t fn;
+    int comp;
+    int op;
+} s_site_ops[] = {
+    { p_plus, 0, MO_ADD },
+    { p_minus, 0, MO_SUB },
+    { p_mul, 0, MO_MUL },
+    { p_eq, 1, MC_EQ },
+    { p_gt, 1, MC_GT },
+    { p_lt, 1, MC_LT },
+    { p_gte, 1, MC_GTE },
+    { p_lte, 1, MC_LTE }
+};
+
+#define MATH_SITE_OPS (int)(sizeof(s_site_ops) / sizeof(s_site_ops[0]))
+
+static int math_site_cmp(math_comp_t op, int cmp) {
+    switch(op) {
+    case MC_EQ:
+        return cmp == 0;
+    case MC_GT:
+        return cmp > 0;
+    case MC_LT:
+        return cmp < 0;
+    case MC_GTE:
+        return cmp >= 0;
+    case MC_LTE:
+        return cmp <= 0;
+    default:
+        assert(0);
+    }
+
+    return 0;
+}
+
+static lv_t *math_site_int(int index, lv_t *a0, lv_t *a1) {
+    lv_t *result;
+
+    if(s_site_ops[index].comp)
+        return lisp_create_bool(
+            math_site_cmp(s_site_ops[index].op, lisp_int_cmp(a0, a1)));
+
+    /* bignums, and results that overflow, take the generic path */
+    if(L_INT_BIG(a0))
+        return NULL;
+
+    result = lisp_create_int(L_FIX(a0));
+    if(!math_fix_op(s_site_ops[index].op, result, a1))
+        return NULL;
+
+    return result;
+}
+
+static lv_t *math_site_float(int index, lv_t *a0, lv_t *a1) {
+    double x = L_FLOAT(a0), y = L_FLOAT(a1);
+
+    if(s_site_ops[index].comp) {
+        switch(s_site_ops[index].op) {
+        case MC_EQ:
+            return lisp_create_bool(x == y);
+        case MC_GT:
+            return lisp_create_bool(x > y);
+        case MC_LT:
+            return lisp_create_bool(x < y);
+        case MC_GTE:
+            return lisp_create_bool(x >= y);
+        case MC_LTE:
+            return lisp_create_bool(x <= y);
+        default:
+            assert(0);
+        }
+    }
+
+    switch(s_site_ops[index].op) {
+    case MO_ADD:
+        return lisp_create_float(x + y);
+    case MO_SUB:
+        return lisp_create_float(x - y);
+    case MO_MUL:
+        return lisp_create_float(x * y);
+    default:
+        assert(0);
+    }
+
+    return NULL;
+}
+
+/**
+ * make the type feedback for a call site of fn, if fn is a
+ * primitive with specialized paths, or return NULL.  The site
+ * is set up by its first call.
+ */
+lmath_site_t *math_site_new(lv_t *fn) {
+    int index;
+
+    if(!fn || fn->type != l_fn || L_FN_FTYPE(fn) != lf_native)
+        return NULL;
+
+    for(index = 0; index < MATH_SITE_OPS; index++)
+        if(s_site_ops[index].fn == L_FN_ARGV(fn))
+            return safe_malloc(sizeof(lmath_site_t));
+
+    return NULL;
+}
+
+/**
+ * run a call of native fn from a site with type feedback.  The
+ * first calls of a site record the operand types it sees; after
+ * that, a site that only saw ints, or only floats, runs them
+ * here without the generic promotion and dispatch.  Returns
+ * NULL for anything the site doesn't cover, including operands
+ * failing the type guard, and the caller makes the call as
+ * usual.
+ */
+lv_t *math_site_op(lexec_t *exec, lmath_site_t **psite,
+                   lv_t *fn, int argc, lv_t **argv) {
+    lmath_site_t *site = *psite;
+    lv_t *a0 = argv[0], *a1 = argv[1];
+    int index;
+
+    assert(exec && fn && L_FN_FTYPE(fn) == lf_native);
+
+    if(!site || site->fn != L_FN_ARGV(fn)) {
+        /* first call, or the operator was rebound */
+        if(!site)
+            *psite = site = safe_malloc(sizeof(lmath_site_t));
+
+        site->fn = L_FN_ARGV(fn);
+        site->op = -1;
+        site->count = 0;
+        site->seen = 0;
+        site->kind = MS_GENERIC;
+
+        for(index = 0; index < MATH_SITE_OPS; index++)
+            if(s_site_ops[index].fn == site->fn)
+                site->op = index;
+
+        if(site->op != -1)
+            site->kind = MS_COLD;
+    }
+
+    if(argc != 2)
+        return NULL;
+
+    switch(site->kind) {
+    case MS_INT:
+        if(a0->type == l_int && a1->type == l_int)
+            return math_site_int(site->op, a0, a1);
+        return NULL;
+    case MS_FLOAT:
+        if(a0->type == l_float && a1->type == l_float)
+            return math_site_float(site->op, a0, a1);
+        return NULL;
+    case MS_COLD:
+        if(a0->type == l_int && a1->type == l_int)
+            site->seen |= 1 << MS_INT;
+        else if(a0->type == l_float && a1->type == l_float)
+            site->seen |= 1 << MS_FLOAT;
+        else
+            site->seen |= 1 << MS_GENERIC;
+
+        if(++site->count == MATH_SITE_WARM) {
+            if(site->seen == 1 << MS_INT)
+                site->kind = MS_INT;
+            else if(site->seen == 1 << MS_FLOAT)
+                site->kind = MS_FLOAT;
+            else
+                site->kind = MS_GENERIC;
+        }
+        return NULL;
+    default:
+        return NULL;
+    }
+}
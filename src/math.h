@@ -21,23 +21,48 @@
 #ifndef _MATH_H_
 #define _MATH_H_
 
+/* operand types a math site is specialized for */
+typedef enum math_site_kind_t {
+    MS_COLD,        // still profiling
+    MS_INT,
+    MS_FLOAT,
+    MS_GENERIC      // mixed, or not a math primitive
+} math_site_kind_t;
+
+/**
+ * type feedback for a call site of a two argument arithmetic or
+ * comparison primitive, see math_site_op
+ */
+struct lmath_site_t {
+    lisp_argv_method_t fn;  // primitive the site was profiled with
+    int op;                 // its entry in the site table, or -1
+    int count;              // calls profiled
+    int seen;               // operand types seen, bits of MS_*
+    math_site_kind_t kind;
+};
+
+extern lmath_site_t *math_site_new(lv_t *fn);
+extern lv_t *math_site_op(lexec_t *exec, lmath_site_t **psite,
+                          lv_t *fn, int argc, lv_t **argv);
+
 extern lv_t *p_integerp(lexec_t *exec, lv_t *v);
 extern lv_t *p_rationalp(lexec_t *exec, lv_t *v);
 extern lv_t *p_floatp(lexec_t *exec, lv_t *v);
 
 extern lv_t *p_exactp(lexec_t *exec, lv_t *v);
 extern lv_t *p_inexactp(lexec_t *exec, lv_t *v);
+extern lv_t *p_bigfloat(lexec_t *exec, lv_t *v);
 
-extern lv_t *p_gt(lexec_t *exec, lv_t *v);
-extern lv_t *p_lt(lexec_t *exec, lv_t *v);
-extern lv_t *p_gte(lexec_t *exec, lv_t *v);
-extern lv_t *p_lte(lexec_t *exec, lv_t *v);
-extern lv_t *p_eq(lexec_t *exec, lv_t *v);
+extern lv_t *p_gt(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_lt(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_gte(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_lte(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_eq(lexec_t *exec, int argc, lv_t **argv);
 
-extern lv_t *p_plus(lexec_t *exec, lv_t *v);
-extern lv_t *p_minus(lexec_t *exec, lv_t *v);
-extern lv_t *p_mul(lexec_t *exec, lv_t *v);
-extern lv_t *p_div(lexec_t *exec, lv_t *v);
+extern lv_t *p_plus(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_minus(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_mul(lexec_t *exec, int argc, lv_t **argv);
+extern lv_t *p_div(lexec_t *exec, int argc, lv_t **argv);
 
 extern lv_t *p_quotient(lexec_t *exec, lv_t *v);
 extern lv_t *p_remainder(lexec_t *exec, lv_t *v);
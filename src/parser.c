@@ -540,6 +540,8 @@ lv_t  *c_parse_port(lexec_t *exec, lv_t *port) {
         while(1) {
             expr = c_parse(exec, port);
             if(expr->type == l_err) { /* eof */
+                /* this gets automatically popped on an exception */
+                lisp_exec_pop_ex(exec);
                 if(!res)
                     return lisp_create_null();
                 return res;
@@ -553,8 +555,6 @@ lv_t  *c_parse_port(lexec_t *exec, lv_t *port) {
                 current = L_CDR(current);
             }
         }
-        /* this gets automatically popped on an exception */
-        lisp_pop_ex(exec);
     }
 
     /* we'll let gc take care of the incomplete list */
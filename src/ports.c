@@ -157,7 +157,6 @@ lv_t *p_close_input_port(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
     lv_t *port = L_CAR(v);
     rt_assert(L_PORT(port)->dir == PD_INPUT,
               le_type, "not an input port");
@@ -321,8 +320,6 @@ lv_t *p_read_char(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
-
     lv_t *port = L_CAR(v);
     rt_assert(port->type == l_port && L_PORT(port)->dir == PD_INPUT,
               le_type, "expecting input port");
@@ -344,8 +341,6 @@ lv_t *p_peek_char(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
-
     lv_t *port = L_CAR(v);
     rt_assert(port->type == l_port && L_PORT(port)->dir == PD_INPUT,
               le_type, "expecting input port");
@@ -361,7 +356,6 @@ lv_t *p_close_output_port(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
     lv_t *port = L_CAR(v);
     rt_assert(L_PORT(port)->dir == PD_OUTPUT,
               le_type, "not an output port");
@@ -387,8 +381,6 @@ lv_t *p_input_portp(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
-
     lv_t *port = L_CAR(v);
     if((port->type == l_port) && (L_PORT(port)->dir == PD_INPUT)) {
         return lisp_create_bool(1);
@@ -406,8 +398,6 @@ lv_t *p_output_portp(lexec_t *exec, lv_t *v) {
     assert(exec);
     assert(v && v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 argument");
-
     lv_t *port = L_CAR(v);
     if((port->type == l_port) && (L_PORT(port)->dir == PD_OUTPUT)) {
         return lisp_create_bool(1);
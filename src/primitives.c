@@ -41,6 +41,11 @@
 #include "math.h"
 #include "parser.h"
 #include "list.h"
+#include "analyze.h"
+#include "vm.h"
+
+/* chunk size of the frame region */
+#define LISP_REGION_SIZE (64 * 1024)
 
 typedef struct hash_node_t {
     uint32_t key;
@@ -48,127 +53,150 @@ typedef struct hash_node_t {
     lv_t *value;
 } hash_node_t;
 
+/**
+ * a primitive to bind, with its arity.  Set either fn, for a
+ * native taking its arguments as a list, or argv_fn, for one
+ * taking them as an argument vector.  Pure primitives have no
+ * side effects, and calls to them on constants are folded when
+ * they are analyzed.
+ */
 typedef struct environment_list_t {
     char *name;
-    lv_t *(*fn)(lexec_t *, lv_t *);
+    int min_args;
+    int max_args;
+    lisp_method_t fn;
+    lisp_argv_method_t argv_fn;
+    int pure;
 } environment_list_t;
 
 typedef enum exec_stack_t {
     es_env,    // environment stack
     es_ex,     // exception stack
-    es_eval    // eval stack (for backtrace)
+    es_eval,   // eval stack (for backtrace)
+    es_wind    // dynamic-wind stack
 } exec_stack_t;
 
 static int stack_offsets[] = {
     offsetof(lexec_t, env_stack),
     offsetof(lexec_t, ex_stack),
-    offsetof(lexec_t, eval_stack)
+    offsetof(lexec_t, eval_stack),
+    offsetof(lexec_t, wind_stack)
 };
 
 static int gmp_initialized = 0;
+
+/* bumped whenever a binding is added or changed by name */
+unsigned int lisp_env_version = 0;
 static jmp_buf *assert_handler = NULL;
 static int emit_on_error = 1;
 
 static environment_list_t s_env_global[] = {
     /* wants at least scheme-report-environment */
-    { NULL, NULL }
+    { NULL, 0, 0, NULL, NULL, 0 }
 };
 
 static environment_list_t s_env_prim[] = {
-    { "p-+", p_plus },
-    { "p-null?", p_nullp },
-    { "p-symbol?", p_symbolp },
-    { "p-atom?", p_atomp },
-    { "p-cons?", p_consp },
-    { "p-list?", p_listp },
-    { "p-pair?", p_pairp },
-    { "p-equal?", p_equalp },
-    { "p-set-cdr!", p_set_cdr },
-    { "p-set-car!", p_set_car },
-    { "p-length", p_length },
-    { "p-inspect", p_inspect },
-    { "p-load", p_load },
-    { "p-assert", p_assert },
-    { "p-warn", p_warn },
-    { "p-not", p_not },
-    { "p-cons", p_cons },
-    { "p-car", p_car },
-    { "p-cdr", p_cdr },
-    { "p-gensym", p_gensym },
-    { "p-display", p_display },
-    { "p-write", p_write },
-    { "p-format", p_format },
+    { "p-+", 0, LISP_ARGS_ANY, NULL, p_plus, 1 },
+    { "p-null?", 1, 1, NULL, p_nullp, 1 },
+    { "p-symbol?", 1, 1, p_symbolp, NULL, 1 },
+    { "p-atom?", 1, 1, p_atomp, NULL, 1 },
+    { "p-cons?", 1, 1, p_consp, NULL, 1 },
+    { "p-list?", 1, 1, p_listp, NULL, 1 },
+    { "p-pair?", 1, 1, NULL, p_pairp, 1 },
+    { "p-equal?", 2, 2, NULL, p_equalp, 1 },
+    { "p-set-cdr!", 2, 2, p_set_cdr, NULL, 0 },
+    { "p-set-car!", 2, 2, p_set_car, NULL, 0 },
+    { "p-length", 1, 1, p_length, NULL, 1 },
+    { "p-inspect", 1, 1, p_inspect, NULL, 0 },
+    { "p-load", 1, 1, p_load, NULL, 0 },
+    { "p-assert", 1, 1, p_assert, NULL, 0 },
+    { "p-warn", 1, 1, p_warn, NULL, 0 },
+    { "p-not", 1, 1, NULL, p_not, 1 },
+    { "p-cons", 2, 2, NULL, p_cons, 0 },
+    { "p-car", 1, 1, NULL, p_car, 1 },
+    { "p-cdr", 1, 1, NULL, p_cdr, 1 },
+    { "p-gensym", 0, 0, p_gensym, NULL, 0 },
+    { "p-cache-stats", 0, 0, p_cache_stats, NULL, 0 },
+    { "p-backtrace", 0, 0, p_backtrace, NULL, 0 },
+    { "p-dynamic-macro", 1, 1, p_dynamic_macro, NULL, 0 },
+    { "p-call/cc", 1, 1, NULL, p_call_cc, 0 },
+    { "p-dynamic-wind", 3, 3, NULL, p_dynamic_wind, 0 },
+    { "p-expand", 1, 1, p_expand, NULL, 0 },
+    { "p-display", 1, 1, p_display, NULL, 0 },
+    { "p-write", 1, 1, p_write, NULL, 0 },
+    { "p-format", 1, LISP_ARGS_ANY, p_format, NULL, 0 },
 
     // list and pair functions
-    { "p-append", p_append },
-    { "p-list", p_list },
-    { "p-reverse", p_reverse },
-    { "p-list-tail", p_list_tail },
-    { "p-list-ref", p_list_ref },
+    { "p-append", 2, LISP_ARGS_ANY, p_append, NULL, 0 },
+    { "p-list", 0, LISP_ARGS_ANY, p_list, NULL, 0 },
+    { "p-reverse", 1, 1, p_reverse, NULL, 0 },
+    { "p-list-tail", 2, 2, p_list_tail, NULL, 0 },
+    { "p-list-ref", 2, 2, p_list_ref, NULL, 0 },
 
     // error functions
-    { "p-error-object?", p_error_objectp },
-    { "p-read-error?", p_read_errorp },
-    { "p-file-error?", p_file_errorp },
-    { "p-eof-error?", p_eof_errorp },
+    { "p-error-object?", 1, 1, p_error_objectp, NULL, 0 },
+    { "p-read-error?", 1, 1, p_read_errorp, NULL, 0 },
+    { "p-file-error?", 1, 1, p_file_errorp, NULL, 0 },
+    { "p-eof-error?", 1, 1, p_eof_errorp, NULL, 0 },
 
     // port functions
-    { "p-input-port?", p_input_portp },
-    { "p-output-port?", p_output_portp },
-    { "p-open-input-file", p_open_input_file },
-    { "p-open-output-file", p_open_output_file },
-    { "p-close-input-port", p_close_input_port },
-    { "p-close-output-port", p_close_output_port },
-    { "p-read-char", p_read_char },
-    { "p-peek-char", p_peek_char },
-
-    { "p-toktest", p_toktest },
-    { "p-parsetest", p_parsetest },
-    { "p-read", p_read },
+    { "p-input-port?", 1, 1, p_input_portp, NULL, 0 },
+    { "p-output-port?", 1, 1, p_output_portp, NULL, 0 },
+    { "p-open-input-file", 1, 1, p_open_input_file, NULL, 0 },
+    { "p-open-output-file", 1, 1, p_open_output_file, NULL, 0 },
+    { "p-close-input-port", 1, 1, p_close_input_port, NULL, 0 },
+    { "p-close-output-port", 1, 1, p_close_output_port, NULL, 0 },
+    { "p-read-char", 1, 1, p_read_char, NULL, 0 },
+    { "p-peek-char", 1, 1, p_peek_char, NULL, 0 },
+
+    { "p-toktest", 1, 1, p_toktest, NULL, 0 },
+    { "p-parsetest", 1, 1, p_parsetest, NULL, 0 },
+    { "p-read", 1, 1, p_read, NULL, 0 },
 
     // char functions
-    { "p-char?", p_charp },
-    { "p-char=?", p_charequalp },
-    { "p-char<?", p_charltp },
-    { "p-char>?", p_chargtp },
-    { "p-char<=?", p_charltep },
-    { "p-char>=?", p_chargtep },
-    { "p-char->integer", p_char_integer },
+    { "p-char?", 1, 1, p_charp, NULL, 1 },
+    { "p-char=?", 2, 2, p_charequalp, NULL, 1 },
+    { "p-char<?", 2, 2, p_charltp, NULL, 1 },
+    { "p-char>?", 2, 2, p_chargtp, NULL, 1 },
+    { "p-char<=?", 2, 2, p_charltep, NULL, 1 },
+    { "p-char>=?", 2, 2, p_chargtep, NULL, 1 },
+    { "p-char->integer", 1, 1, p_char_integer, NULL, 1 },
 
     // math functions
-    { "p-integer?", p_integerp },
-    { "p-rational?", p_rationalp },
-    { "p-float?" , p_floatp },
-    { "p-exact?" , p_exactp },
-    { "p-inexact?", p_inexactp },
-    { "p->", p_gt },
-    { "p-<", p_lt },
-    { "p->=", p_gte },
-    { "p-<=", p_lte },
-    { "p-=", p_eq },
-    { "p-+", p_plus },
-    { "p--", p_minus },
-    { "p-*", p_mul },
-    { "p-/", p_div },
-    { "p-quotient", p_quotient },
-    { "p-remainder", p_remainder },
-    { "p-modulo", p_modulo },
-    { "p-floor", p_floor },
-    { "p-ceiling", p_ceiling },
-    { "p-truncate", p_truncate },
-    { "p-round", p_round },
-    { "p-sin", p_sin },
-    { "p-cos", p_cos },
-    { "p-tan", p_tan },
-    { "p-asin", p_asin },
-    { "p-acos", p_acos },
-    { "p-atan", p_atan },
-    { "p-number->string", p_number2string },
+    { "p-integer?", 1, 1, p_integerp, NULL, 1 },
+    { "p-rational?", 1, 1, p_rationalp, NULL, 1 },
+    { "p-float?", 1, 1, p_floatp, NULL, 1 },
+    { "p-exact?", 1, 1, p_exactp, NULL, 1 },
+    { "p-inexact?", 1, 1, p_inexactp, NULL, 1 },
+    { "p-bigfloat", 2, 2, p_bigfloat, NULL, 1 },
+    { "p->", 2, 2, NULL, p_gt, 1 },
+    { "p-<", 2, 2, NULL, p_lt, 1 },
+    { "p->=", 2, 2, NULL, p_gte, 1 },
+    { "p-<=", 2, 2, NULL, p_lte, 1 },
+    { "p-=", 2, 2, NULL, p_eq, 1 },
+    { "p-+", 0, LISP_ARGS_ANY, NULL, p_plus, 1 },
+    { "p--", 1, LISP_ARGS_ANY, NULL, p_minus, 1 },
+    { "p-*", 0, LISP_ARGS_ANY, NULL, p_mul, 1 },
+    { "p-/", 1, LISP_ARGS_ANY, NULL, p_div, 1 },
+    { "p-quotient", 2, 2, p_quotient, NULL, 1 },
+    { "p-remainder", 2, 2, p_remainder, NULL, 1 },
+    { "p-modulo", 2, 2, p_modulo, NULL, 1 },
+    { "p-floor", 1, 1, p_floor, NULL, 1 },
+    { "p-ceiling", 1, 1, p_ceiling, NULL, 1 },
+    { "p-truncate", 1, 1, p_truncate, NULL, 1 },
+    { "p-round", 1, 1, p_round, NULL, 1 },
+    { "p-sin", 1, 1, p_sin, NULL, 1 },
+    { "p-cos", 1, 1, p_cos, NULL, 1 },
+    { "p-tan", 1, 1, p_tan, NULL, 1 },
+    { "p-asin", 1, 1, p_asin, NULL, 1 },
+    { "p-acos", 1, 1, p_acos, NULL, 1 },
+    { "p-atan", 1, 1, p_atan, NULL, 1 },
+    { "p-number->string", 1, 1, p_number2string, NULL, 0 },
 
     // SRFI-6
-    { "p-open-input-string", p_open_input_string },
+    { "p-open-input-string", 1, 1, p_open_input_string, NULL, 0 },
 
-    { NULL, NULL }
+    { NULL, 0, 0, NULL, NULL, 0 }
 };
 
 /**
@@ -199,6 +227,15 @@ void lisp_set_ehandler(lexec_t *exec, void(*handler)(lexec_t *exec)) {
     exec->ehandler = handler;
 }
 
+/**
+ * select the engine used to run evaluated code
+ */
+void lisp_set_engine(lexec_t *exec, lisp_engine_t engine) {
+    assert(exec);
+
+    exec->engine = engine;
+}
+
 void null_ehandler(lexec_t *exec) {
 }
 
@@ -214,6 +251,8 @@ void default_ehandler(lexec_t *exec) {
     lstack_t *pstack;
     char buffer[256]; /* FIXME: decent display or print */
     int show_line;
+    int row, col;
+    char *file;
     lv_t *arg;
     lisp_exception_t etype;
     char *msg;
@@ -236,25 +275,23 @@ void default_ehandler(lexec_t *exec) {
         arg = (lv_t*)pstack->data;
 
         if(arg->type == l_fn) {
-            if(L_FN(arg)) {
+            if(L_FN_FTYPE(arg) == lf_native) {
                 strcpy(buffer, "built-in function");
                 show_line = 0;
             } else {
-                strcpy(buffer, "lambda, declared at");
+                strcpy(buffer, "lambda");
             }
         } else {
             strcat(buffer, lisp_types_list[arg->type] + 2);
         }
 
-        if(show_line)
-            sprintf(buffer + strlen(buffer), " %s:%d:%d",
-                    arg->file,
-                    arg->row,
-                    arg->col);
+        if(show_line && lisp_value_pos(arg, &row, &col, &file))
+            sprintf(buffer + strlen(buffer), ", declared at %s:%d:%d",
+                    file, row, col);
 
-        if(arg->bound)
+        if(arg->type == l_fn && L_FN_BOUND(arg))
             sprintf(buffer + strlen(buffer), ", bound to '%s'",
-                    L_SYM(arg->bound));
+                    L_SYM(L_FN_BOUND(arg)));
 
 
         fprintf(stderr, "%d: %s\n", index, buffer);
@@ -326,6 +363,10 @@ void c_hash_walk(lv_t *hash, void(*callback)(lv_t *, lv_t *)) {
     assert(callback);
 
     void hash_walker(const void *np, const VISIT w, const int d, void *msg) {
+        /* skip cells that were linked but never defined */
+        if(!((hash_node_t *)np)->value)
+            return;
+
         if(w == leaf || w == postorder) {
             // inorder, strangely
             callback(((hash_node_t *)np)->key_item,
@@ -371,12 +412,36 @@ int c_hash_insert(lv_t *hash,
 
     assert(result);
 
+    lisp_env_version++;
     result->value = value;
     result->key_item = key;
 
     return(result != NULL);
 }
 
+/**
+ * get the binding cell for key, adding an unbound (NULL) one if
+ * the key is not in the hash yet.  Cells never move, and
+ * c_hash_insert updates them in place, so the cell can be held
+ * on to as a direct pointer to the binding.
+ */
+lv_t **c_hash_cell(lv_t *hash, lv_t *key) {
+    hash_node_t *pnew;
+    hash_node_t *result;
+
+    assert(hash->type == l_hash);
+    assert(key->type == l_str || key->type == l_sym);
+
+    pnew = safe_malloc(sizeof(hash_node_t));
+    pnew->key = s_hash_item(key);
+    pnew->key_item = key;
+
+    result = (hash_node_t *)rbsearch((void*)pnew, L_HASH(hash));
+    assert(result);
+
+    return &result->value;
+}
+
 int c_hash_delete(lv_t *hash, lv_t *key) {
     hash_node_t node_key;
     hash_node_t *result;
@@ -386,19 +451,78 @@ int c_hash_delete(lv_t *hash, lv_t *key) {
 
     node_key.key = s_hash_item(key);
     result = (hash_node_t *)rbdelete(&node_key, L_HASH(hash));
+    lisp_env_version++;
     return(result != NULL);
 }
 
+/**
+ * find the slot of a name in a frame, or -1
+ */
+static int s_frame_slot(lv_t *frame, lv_t *key) {
+    lv_t *names = L_FRAME_SCOPE(frame)->names;
+    char *name = (key->type == l_sym) ? L_SYM(key) : L_STR(key);
+    int slot;
+
+    for(slot = 0; slot < L_FRAME_COUNT(frame); slot++) {
+        if(!strcmp(L_SYM(L_CAR(names)), name))
+            return slot;
+        names = L_CDR(names);
+    }
+
+    return -1;
+}
+
+lv_t *c_frame_fetch(lv_t *frame, lv_t *key) {
+    int slot;
+
+    assert(frame && frame->type == l_frame);
+    assert(key && (key->type == l_str || key->type == l_sym));
+
+    slot = s_frame_slot(frame, key);
+    if(slot != -1 && L_FRAME_SLOT(frame, slot))
+        return L_FRAME_SLOT(frame, slot);
+
+    if(L_FRAME_EXTRA(frame))
+        return c_hash_fetch(L_FRAME_EXTRA(frame), key);
+
+    return NULL;
+}
+
+int c_frame_insert(lv_t *frame, lv_t *key, lv_t *value) {
+    int slot;
+
+    assert(frame->type == l_frame);
+    assert(key->type == l_str || key->type == l_sym);
+
+    lisp_env_version++;
+
+    slot = s_frame_slot(frame, key);
+    if(slot != -1) {
+        L_FRAME_SLOT(frame, slot) = value;
+        return 1;
+    }
+
+    if(!L_FRAME_EXTRA(frame))
+        L_FRAME_EXTRA(frame) = lisp_create_hash();
+
+    return c_hash_insert(L_FRAME_EXTRA(frame), key, value);
+}
+
+lv_t lisp_null_value = { .type = l_null };
+lv_t lisp_true_value = { .type = l_bool, .value.b.value = 1 };
+lv_t lisp_false_value = { .type = l_bool, .value.b.value = 0 };
+
+/* one of each char, filled in as they are asked for */
+static lv_t s_chars[256];
+
 lv_t *lisp_create_null(void) {
-    lv_t *result = safe_malloc(sizeof(lv_t));
-    result->type = l_null;
-    return result;
+    return LISP_NULL;
 }
 
 lv_t *lisp_create_hash(void) {
     lv_t *result;
 
-    result = safe_malloc(sizeof(lv_t));
+    result = safe_malloc(LV_SIZE(h));
     result->type = l_hash;
     L_HASH(result) = rbinit(s_hash_cmp, NULL);
 
@@ -407,15 +531,124 @@ lv_t *lisp_create_hash(void) {
     return result;
 }
 
+static lv_t *s_frame_init(lv_t *result, lscope_t *scope) {
+    result->type = l_frame;
+    L_FRAME_SCOPE(result) = scope;
+    L_FRAME_COUNT(result) = scope->count;
+    L_FRAME_SLOTS(result) = (lv_t **)((char *)result + LV_SIZE(fr));
+
+    return result;
+}
+
+/**
+ * create an activation frame with a slot for each name in
+ * scope.  The slots are allocated with the frame, and start
+ * out unbound (NULL).
+ */
+lv_t *lisp_create_frame(lscope_t *scope) {
+    return s_frame_init(safe_malloc(LV_SIZE(fr) +
+                                    scope->count * sizeof(lv_t *)), scope);
+}
+
+/**
+ * allocate from the frame region of the context.  The region is
+ * a stack: lisp_region_release hands back everything allocated
+ * since a mark, so it only holds the frames (and env pairs) of
+ * calls whose frames can't escape.  Chunks come from the
+ * collector, so whatever the frames point to stays alive, and a
+ * chunk left behind is collected once nothing points into it.
+ */
+void *lisp_region_alloc(lexec_t *exec, size_t size) {
+    lregion_t *region = &exec->region;
+    void *result;
+
+    size = (size + 15) & ~(size_t)15;
+    if(size > LISP_REGION_SIZE / 4)
+        return safe_malloc(size);
+
+    if(!region->base || region->top + size > LISP_REGION_SIZE) {
+        region->base = safe_malloc(LISP_REGION_SIZE);
+        region->top = 0;
+    }
+
+    result = region->base + region->top;
+    region->top += size;
+
+    memset(result, 0, size);
+    return result;
+}
+
+/**
+ * release everything allocated from the region since mark.  If
+ * the chunk has changed since, the mark is stale and the new
+ * chunk is kept as it is.
+ */
+void lisp_region_release(lexec_t *exec, lregion_t *mark) {
+    if(exec->region.base == mark->base && mark->top < exec->region.top)
+        exec->region.top = mark->top;
+}
+
+int lisp_region_contains(lexec_t *exec, void *ptr) {
+    char *p = ptr;
+
+    return exec->region.base && p >= exec->region.base &&
+        p < exec->region.base + LISP_REGION_SIZE;
+}
+
+/**
+ * keep everything allocated from the region so far.  The current
+ * chunk is left in place as it is, and allocation goes on in a
+ * new one.
+ */
+void lisp_region_keep(lexec_t *exec) {
+    exec->region.base = NULL;
+    exec->region.top = 0;
+}
+
+/**
+ * keep the region frames in env from being released, for
+ * anything that holds on to env after the calls that made them
+ * return.
+ */
+void lisp_region_pin(lexec_t *exec, lv_t *env) {
+    for(; env && env->type == l_pair; env = L_CDR(env)) {
+        if(lisp_region_contains(exec, env) ||
+           lisp_region_contains(exec, L_CAR(env))) {
+            lisp_region_keep(exec);
+            return;
+        }
+    }
+}
+
+/**
+ * make the env for a call of fn, with its frame on top.  Calls
+ * whose frames never escape take the env pair from the region
+ * too.
+ */
+static lv_t *s_call_env(lexec_t *exec, lv_t *fn, lv_t *layer) {
+    lv_t *env;
+
+    if(!L_FN_SCOPE(fn)->transient)
+        return lisp_create_pair(layer, L_FN_ENV(fn));
+
+    env = lisp_region_alloc(exec, LV_SIZE(p));
+    env->type = l_pair;
+    L_CAR(env) = layer;
+    L_CDR(env) = L_FN_ENV(fn);
+
+    return env;
+}
+
+
 lv_t *lisp_create_pair(lv_t *car, lv_t *cdr) {
     lv_t *result;
 
-    result = safe_malloc(sizeof(lv_t));
+    result = safe_malloc(LV_SIZE(p));
 
     result->type = l_pair;
     L_CAR(result) = car;
 
-    if(cdr && cdr->type == l_null)
+    if(cdr == LISP_NULL)
         L_CDR(result) = NULL;
     else
         L_CDR(result) = cdr;
@@ -423,37 +656,57 @@ lv_t *lisp_create_pair(lv_t *car, lv_t *cdr) {
     return result;
 }
 
+/* cell size of each type, see LV_SIZE */
+static size_t s_type_size[l_max] = {
+    [l_int] = LV_SIZE(i),
+    [l_rational] = LV_SIZE(r),
+    [l_float] = LV_SIZE(f),
+    [l_bigfloat] = LV_SIZE(bf),
+    [l_bool] = LV_SIZE(b),
+    [l_sym] = LV_SIZE(s),
+    [l_str] = LV_SIZE(c),
+    [l_pair] = LV_SIZE(p),
+    [l_hash] = LV_SIZE(h),
+    [l_frame] = LV_SIZE(fr),
+    [l_null] = LV_SIZE(p),
+    [l_port] = LV_SIZE(port),
+    [l_char] = LV_SIZE(ch),
+    [l_fn] = LV_SIZE(l),
+    [l_err] = LV_SIZE(e)
+};
+
 lv_t *lisp_create_type(void *value, lisp_type_t type) {
     lv_t *result;
 
-    result = safe_malloc(sizeof(lv_t));
+    assert(type < l_max);
+    result = safe_malloc(s_type_size[type]);
 
     result->type = type;
 
-    result->row = 0;
-    result->col = 0;
-    result->file = NULL;
-
     switch(type) {
     case l_char:
         L_CHAR(result) = *((char*)value);
         break;
     case l_int:
-        mpz_init(L_INT(result));
-        mpz_set_si(L_INT(result), *(int64_t *)value);
+        L_INT_BIG(result) = 0;
+        L_FIX(result) = *(int64_t *)value;
         break;
     case l_rational:
         mpq_init(L_RAT(result));
         break;
     case l_float:
-        mpfr_init(L_FLOAT(result));
-        mpfr_set_d(L_FLOAT(result), *(double*)value, MPFR_ROUND_TYPE);
+        L_FLOAT(result) = *(double*)value;
+        break;
+    case l_bigfloat:
+        mpfr_init2(L_BIGFLOAT(result), *(mpfr_prec_t*)value);
+        mpfr_set_zero(L_BIGFLOAT(result), 1);
         break;
     case l_bool:
         L_BOOL(result) = *((int*)value);
         break;
     case l_sym:
         L_SYM(result) = safe_strdup((char*)value);
+        L_SYM_FORM(result) = lisp_form_tag(L_SYM(result));
         break;
     case l_str:
         L_STR(result) = safe_strdup((char*)value);
@@ -480,7 +733,14 @@ lv_t *lisp_create_type(void *value, lisp_type_t type) {
  * typechecked wrapper around lisp_create_type for chars
  */
 lv_t *lisp_create_char(char value) {
-    return lisp_create_type((void*)&value, l_char);
+    lv_t *result = &s_chars[(unsigned char)value];
+
+    if(result->type != l_char) {
+        result->type = l_char;
+        L_CHAR(result) = value;
+    }
+
+    return result;
 }
 
 /**
@@ -558,20 +818,22 @@ lv_t *lisp_create_float(double value) {
 
 /**
  * lisp_create_type for float, using the string parser
- * (to be able to represent arbitrary precision).  This
- * is the preferred interface
  */
 lv_t *lisp_create_float_str(char *value) {
-    double v = 0;
-    int flag;
+    char *end;
+    double v;
 
-    lv_t *new_value = lisp_create_type((void*)&v, l_float);
+    v = strtod(value, &end);
+    assert(end != value && !*end);
 
-    /* now parse the string */
-    flag = mpfr_set_str(L_FLOAT(new_value), value, 10, MPFR_ROUND_TYPE);
-    assert(!flag);
+    return lisp_create_type((void*)&v, l_float);
+}
 
-    return new_value;
+/**
+ * create a bigfloat of zero, with prec bits of mantissa
+ */
+lv_t *lisp_create_bigfloat(mpfr_prec_t prec) {
+    return lisp_create_type((void*)&prec, l_bigfloat);
 }
 
 /**
@@ -587,31 +849,115 @@ lv_t *lisp_create_int(int64_t value) {
  * is the preferred interface
  */
 lv_t *lisp_create_int_str(char *value) {
-    int64_t v = 0;
     int flag;
 
-    lv_t *new_value = lisp_create_type((void*)&v, l_int);
+    lv_t *new_value = lisp_create_bigint();
 
     /* now parse the string */
     flag = mpz_set_str(L_INT(new_value), value, 10);
     assert(!flag);
 
+    return lisp_int_normalize(new_value);
+}
+
+/**
+ * create an int held as a bignum of 0, to be set with mpz calls
+ * and then passed through lisp_int_normalize
+ */
+lv_t *lisp_create_bigint(void) {
+    int64_t v = 0;
+    lv_t *new_value = lisp_create_type((void*)&v, l_int);
+
+    L_INT_BIG(new_value) = 1;
+    mpz_init(L_INT(new_value));
+
     return new_value;
 }
 
+/**
+ * turn a bignum that fits in a fixnum into one, in place, so
+ * every int has a single representation.  Returns v.
+ */
+lv_t *lisp_int_normalize(lv_t *v) {
+    int64_t fix;
+
+    assert(v && v->type == l_int);
+
+    if(L_INT_BIG(v) && mpz_fits_slong_p(L_INT(v))) {
+        fix = mpz_get_si(L_INT(v));
+        L_INT_BIG(v) = 0;
+        L_FIX(v) = fix;
+    }
+
+    return v;
+}
+
+/**
+ * the value of an int as an mpz: a bignum's own, or tmp set to
+ * the value of a fixnum
+ */
+mpz_ptr lisp_int_mpz(lv_t *v, mpz_t tmp) {
+    assert(v && v->type == l_int);
+
+    if(L_INT_BIG(v))
+        return L_INT(v);
+
+    mpz_init_set_si(tmp, L_FIX(v));
+    return tmp;
+}
+
+/**
+ * the value of an int, which for a bignum is its low bits, as
+ * mpz_get_si
+ */
+int64_t lisp_int_get(lv_t *v) {
+    assert(v && v->type == l_int);
+
+    return L_INT_BIG(v) ? mpz_get_si(L_INT(v)) : L_FIX(v);
+}
+
+/**
+ * compare two ints, returning <0, 0 or >0 as mpz_cmp
+ */
+int lisp_int_cmp(lv_t *a, lv_t *b) {
+    mpz_t ta, tb;
+
+    assert(a && b && a->type == l_int && b->type == l_int);
+
+    if(!L_INT_BIG(a) && !L_INT_BIG(b))
+        return (L_FIX(a) > L_FIX(b)) - (L_FIX(a) < L_FIX(b));
+
+    return mpz_cmp(lisp_int_mpz(a, ta), lisp_int_mpz(b, tb));
+}
+
+/**
+ * the sign of an int, as mpz_sgn
+ */
+int lisp_int_sgn(lv_t *v) {
+    assert(v && v->type == l_int);
+
+    if(L_INT_BIG(v))
+        return mpz_sgn(L_INT(v));
+
+    return (L_FIX(v) > 0) - (L_FIX(v) < 0);
+}
+
 /**
  * typechecked wrapper around lisp_create_type for bools
  */
 lv_t *lisp_create_bool(int value) {
-    return lisp_create_type((void*)&value, l_bool);
+    return value ? LISP_TRUE : LISP_FALSE;
 }
 
 /**
- * typechecked wrapper around lisp_create_type for functions
+ * typechecked wrapper around lisp_create_type for functions,
+ * taking between min_args and max_args arguments
  */
-lv_t *lisp_create_native_fn(lisp_method_t value) {
+lv_t *lisp_create_native_fn(lisp_method_t value, int min_args, int max_args) {
     lv_t *fn = lisp_create_type(value, l_fn);
     L_FN_FTYPE(fn) = lf_native;
+    L_FN_MIN_ARGS(fn) = min_args;
+    L_FN_MAX_ARGS(fn) = max_args;
     L_FN_ARGS(fn) = NULL;
     L_FN_BODY(fn) = NULL;
     L_FN_ENV(fn) = NULL;
@@ -619,6 +965,20 @@ lv_t *lisp_create_native_fn(lisp_method_t value) {
     return fn;
 }
 
+/**
+ * create a native function that takes its arguments as an
+ * argument vector rather than a list
+ */
+lv_t *lisp_create_argv_fn(lisp_argv_method_t value, int min_args, int max_args) {
+    lv_t *fn = lisp_create_type(NULL, l_fn);
+    L_FN_FTYPE(fn) = lf_native;
+    L_FN_ARGV(fn) = value;
+    L_FN_MIN_ARGS(fn) = min_args;
+    L_FN_MAX_ARGS(fn) = max_args;
+
+    return fn;
+}
+
 /**
  * create an error object
  *
@@ -656,6 +1016,8 @@ lv_t *lisp_create_macro(lexec_t *exec, lv_t *formals, lv_t *form) {
     L_FN_ARGS(fn) = formals;
     L_FN_BODY(fn) = form;
 
+    lisp_region_pin(exec, exec->env);
+
     return fn;
 }
 
@@ -677,16 +1039,141 @@ lv_t *lisp_create_lambda(lexec_t *exec, lv_t *formals, lv_t *body) {
     L_FN_ARGS(fn) = formals;
     L_FN_BODY(fn) = body;
 
+    /* one argument per formal, and any number more for a
+     * symbol or improper list */
+    L_FN_MIN_ARGS(fn) = 0;
+    while(formals && formals->type == l_pair && L_CAR(formals)) {
+        L_FN_MIN_ARGS(fn)++;
+        formals = L_CDR(formals);
+    }
+
+    L_FN_MAX_ARGS(fn) = L_FN_MIN_ARGS(fn);
+    if(formals && formals->type == l_sym)
+        L_FN_MAX_ARGS(fn) = LISP_ARGS_ANY;
+
     return fn;
 }
 
 /**
- * stamp row/col/file information on a type
+ * source positions, kept off to the side so that cells don't
+ * carry them.  Keys are hidden from the collector, and link is
+ * cleared when the value is collected, so the table never keeps
+ * a form alive.  Entries whose value was collected are swept out
+ * whenever the table has doubled since the last sweep.
+ */
+typedef struct lpos_t {
+    GC_word key;        // hidden address of the value
+    void *link;         // the same, until the value is collected
+    int row;
+    int col;
+    char *file;
+} lpos_t;
+
+#define POS_SWEEP_MIN 1024
+
+static struct rbtree *s_pos_table;
+static size_t s_pos_count;
+static size_t s_pos_sweep = POS_SWEEP_MIN;
+
+static int s_pos_cmp(const void *a, const void *b, const void *config) {
+    lpos_t *p1 = (lpos_t *)a;
+    lpos_t *p2 = (lpos_t *)b;
+
+    if(p1->key > p2->key)
+        return 1;
+    if(p1->key < p2->key)
+        return -1;
+    return 0;
+}
+
+/**
+ * drop the entries whose value has been collected
+ */
+static void s_pos_prune(void) {
+    RBLIST *list;
+    lpos_t *pos;
+    lpos_t **dead;
+    size_t count = 0;
+    size_t i;
+
+    dead = safe_malloc(s_pos_count * sizeof(lpos_t *));
+    list = rbopenlist(s_pos_table);
+    while((pos = (lpos_t *)rbreadlist(list)))
+        if(!pos->link && count < s_pos_count)
+            dead[count++] = pos;
+    rbcloselist(list);
+
+    for(i = 0; i < count; i++)
+        rbdelete(dead[i], s_pos_table);
+
+    s_pos_count -= count;
+    s_pos_sweep = s_pos_count * 2;
+    if(s_pos_sweep < POS_SWEEP_MIN)
+        s_pos_sweep = POS_SWEEP_MIN;
+}
+
+/**
+ * stamp row/col/file information on a value
  */
 void lisp_stamp_value(lv_t *v, int row, int col, char *file) {
-    v->row = row;
-    v->col = col;
-    v->file = file;
+    lpos_t key;
+    lpos_t *pos;
+
+    if(!s_pos_table)
+        s_pos_table = rbinit(s_pos_cmp, NULL);
+
+    key.key = GC_HIDE_POINTER(v);
+    pos = (lpos_t *)rbfind(&key, s_pos_table);
+
+    if(!pos) {
+        if(s_pos_count >= s_pos_sweep)
+            s_pos_prune();
+
+        pos = safe_malloc(sizeof(lpos_t));
+        pos->key = key.key;
+        rbsearch((void *)pos, s_pos_table);
+        s_pos_count++;
+    }
+
+    if(!pos->link) {
+        pos->link = (void *)GC_HIDE_POINTER(v);
+        GC_general_register_disappearing_link(&pos->link, v);
+    }
+
+    pos->row = row;
+    pos->col = col;
+    pos->file = file;
+}
+
+/**
+ * find where a value was read from, returning 0 if it was never
+ * stamped.  A lambda is where its body is.
+ */
+int lisp_value_pos(lv_t *v, int *row, int *col, char **file) {
+    lpos_t key;
+    lpos_t *pos;
+
+    if(v && v->type == l_fn)
+        v = L_FN_FTYPE(v) == lf_native ? NULL : L_FN_BODY(v);
+
+    if(!v || !s_pos_table)
+        return 0;
+
+    key.key = GC_HIDE_POINTER(v);
+    pos = (lpos_t *)rbfind(&key, s_pos_table);
+    if(!pos)
+        return 0;
+
+    if(!pos->link) {
+        rbdelete(&key, s_pos_table);
+        s_pos_count--;
+        return 0;
+    }
+
+    *row = pos->row;
+    *col = pos->col;
+    *file = pos->file;
+    return 1;
 }
 
 /**
@@ -706,13 +1193,18 @@ int lisp_snprintf(lexec_t *exec, char *buf, int len, lv_t *v, int display) {
     case l_null:
         return snprintf(buf, len, "()");
     case l_int:
-        /* return snprintf(buf, len, "%" PRIu64, L_INT(v)); */
+        if(!L_INT_BIG(v))
+            return snprintf(buf, len, "%" PRId64, L_FIX(v));
         return gmp_snprintf(buf, len, "%Zd", L_INT(v));
     case l_rational:
         return gmp_snprintf(buf, len, "%Qd", L_RAT(v));
     case l_float:
-        /* return snprintf(buf, len, "%0.16g", L_FLOAT(v)); */
-        return mpfr_snprintf(buf, len, "%Rg", L_FLOAT(v));
+        return snprintf(buf, len, "%g", L_FLOAT(v));
+    case l_bigfloat:
+        /* as many digits as the precision holds */
+        return mpfr_snprintf(buf, len, "%.*Rg",
+                             (int)(mpfr_get_prec(L_BIGFLOAT(v)) * 0.30103),
+                             L_BIGFLOAT(v));
     case l_bool:
         return snprintf(buf, len, "%s", L_BOOL(v) ? "#t": "#f");
     case l_sym:
@@ -764,7 +1256,7 @@ int lisp_snprintf(lexec_t *exec, char *buf, int len, lv_t *v, int display) {
     case l_fn:
         rt_assert(!display, le_type, "cannot display function types");
 
-        if(L_FN(v) == NULL)
+        if(L_FN_FTYPE(v) != lf_native)
             return snprintf(buf, len, "<lambda@%p>", v);
         else
             return snprintf(buf, len, "<built-in@%p>", v);
@@ -804,16 +1296,26 @@ lv_t *lisp_str_from_value(lexec_t *exec, lv_t *v, int display) {
  * print a value to a fd, in a debug form
  */
 void lisp_dump_value(int fd, lv_t *v, int level) {
+    char *str;
+
     switch(v->type) {
     case l_null:
         dprintf(fd, "()");
         break;
     case l_int:
-        dprintf(fd, "%" PRIu64, L_INT(v));
+        if(!L_INT_BIG(v))
+            dprintf(fd, "%" PRId64, L_FIX(v));
+        else
+            dprintf(fd, "%s", mpz_get_str(NULL, 10, L_INT(v)));
         break;
     case l_float:
         dprintf(fd, "%0.16g", L_FLOAT(v));
         break;
+    case l_bigfloat:
+        mpfr_asprintf(&str, "%Rg", L_BIGFLOAT(v));
+        dprintf(fd, "%s", str);
+        mpfr_free_str(str);
+        break;
     case l_bool:
         dprintf(fd, "%s", L_BOOL(v) ? "#t": "#f");
         break;
@@ -843,7 +1345,7 @@ void lisp_dump_value(int fd, lv_t *v, int level) {
         dprintf(fd, ")");
         break;
     case l_fn:
-        if(L_FN(v) == NULL)
+        if(L_FN_FTYPE(v) != lf_native)
             dprintf(fd, "<lambda@%p>", v);
         else
             dprintf(fd, "<built-in@%p>", v);
@@ -854,46 +1356,57 @@ void lisp_dump_value(int fd, lv_t *v, int level) {
     }
 }
 
-lv_t *lisp_args_overlay(lexec_t *exec, lv_t *formals, lv_t *args) {
+/**
+ * bind the arguments of a call to fn into a new activation
+ * frame, one slot per formal with the rest list (if any) last
+ */
+lv_t *lisp_args_overlay(lexec_t *exec, lv_t *fn, lv_t *args) {
     lv_t *pf, *pa;
-    lv_t *env_layer;
+    lv_t *frame;
+    int slot = 0;
 
-    assert(formals->type == l_pair ||
-           formals->type == l_null ||
-           formals->type == l_sym);
+    assert(fn->type == l_fn && L_FN_FTYPE(fn) != lf_native);
     assert(args->type == l_pair || args->type == l_null || args->type == l_sym);
 
-    env_layer = lisp_create_hash();
-    pf = formals;
+    /* the frame layout comes with the analyzed body */
+    lisp_fn_code(exec, fn);
+
+    if(L_FN_SCOPE(fn)->transient)
+        frame = s_frame_init(lisp_region_alloc(
+                                 exec, LV_SIZE(fr) + L_FN_SCOPE(fn)->count *
+                                 sizeof(lv_t *)), L_FN_SCOPE(fn));
+    else
+        frame = lisp_create_frame(L_FN_SCOPE(fn));
+    pf = L_FN_ARGS(fn);
     pa = args;
 
     /* no args */
     if(pf->type == l_null) {
         rt_assert(c_list_length(pa) == 0, le_arity, "too many arguments");
-        return env_layer;
+        return frame;
     }
 
     /* single arg gets the whole list */
     if(pf->type == l_sym) {
-        c_hash_insert(env_layer, pf, lisp_dup_item(pa));
-        return env_layer;
+        L_FRAME_SLOT(frame, 0) = lisp_dup_item(pa);
+        return frame;
     }
 
     /* walk through the formal list, matching to args */
     while(pf && L_CAR(pf)) {
         rt_assert(pa && L_CAR(pa), le_arity, "not enough arguments");
-        c_hash_insert(env_layer, L_CAR(pf), L_CAR(pa));
+        L_FRAME_SLOT(frame, slot++) = L_CAR(pa);
         pf = L_CDR(pf);
         pa = L_CDR(pa);
 
         if(pf && pf->type == l_sym) {
             /* improper list */
             if(!pa) {
-                c_hash_insert(env_layer, pf, lisp_create_null());
+                L_FRAME_SLOT(frame, slot) = lisp_create_null();
             } else {
-                c_hash_insert(env_layer, pf, lisp_dup_item(pa));
+                L_FRAME_SLOT(frame, slot) = lisp_dup_item(pa);
             }
-            return env_layer;
+            return frame;
         }
 
         rt_assert(!pf || pf->type == l_pair, le_type, "unexpected formal type");
@@ -901,14 +1414,70 @@ lv_t *lisp_args_overlay(lexec_t *exec, lv_t *formals, lv_t *args) {
 
     rt_assert(!pa, le_arity, "too many arguments");
 
-    return env_layer;
+    return frame;
+}
+
+/**
+ * check a call of fn with argc arguments against its arity
+ */
+void lisp_check_arity(lexec_t *exec, lv_t *fn, int argc) {
+    rt_assert(argc >= L_FN_MIN_ARGS(fn), le_arity, "not enough arguments");
+    rt_assert(L_FN_MAX_ARGS(fn) == LISP_ARGS_ANY ||
+              argc <= L_FN_MAX_ARGS(fn), le_arity, "too many arguments");
+}
+
+/**
+ * call an argument vector native with an argument list
+ */
+static lv_t *s_exec_argv_list(lexec_t *exec, lv_t *fn, lv_t *args) {
+    lv_t *argv[c_list_length(args) + 1];
+    int argc = 0;
+
+    if(args->type == l_pair) {
+        while(args) {
+            argv[argc++] = L_CAR(args);
+            args = L_CDR(args);
+        }
+    }
+
+    return L_FN_ARGV(fn)(exec, argc, argv);
+}
+
+/**
+ * call a function with arguments already evaluated into an
+ * array.  Arity is checked from argc, argument vector natives
+ * take the array as it is, and only lambdas and list natives
+ * pay for an argument list.
+ */
+lv_t *lisp_exec_argv(lexec_t *exec, lv_t *fn, int argc, lv_t **argv) {
+    lv_t *result;
+
+    assert(exec && fn);
+    rt_assert(fn->type == l_fn, le_type, "not a function");
+
+    if(L_FN_FTYPE(fn) != lf_native) {
+        if(L_FN_FTYPE(fn) == lf_lambda)
+            lisp_check_arity(exec, fn, argc);
+        return lisp_exec_fn(exec, fn, c_array_to_list(argc, argv));
+    }
+
+    lisp_exec_push_eval(exec, fn);
+    lisp_check_arity(exec, fn, argc);
+
+    if(L_FN_ARGV(fn))
+        result = L_FN_ARGV(fn)(exec, argc, argv);
+    else
+        result = L_FN(fn)(exec, c_array_to_list(argc, argv));
+
+    lisp_exec_pop_eval(exec);
+
+    return result;
 }
 
 lv_t *lisp_exec_fn(lexec_t *exec, lv_t *fn, lv_t *args) {
-    lv_t *parsed_args;
     lv_t *layer, *newenv;
-    lv_t *macrofn;
     lv_t *result;
+    lregion_t mark = exec->region;
 
     assert(exec && fn && args);
     rt_assert(fn->type == l_fn, le_type, "not a function");
@@ -917,22 +1486,22 @@ lv_t *lisp_exec_fn(lexec_t *exec, lv_t *fn, lv_t *args) {
 
     switch(L_FN_FTYPE(fn)) {
     case lf_native:
-        result = L_FN(fn)(exec, args);
+        lisp_check_arity(exec, fn, c_list_length(args));
+        if(L_FN_ARGV(fn))
+            result = s_exec_argv_list(exec, fn, args);
+        else
+            result = L_FN(fn)(exec, args);
         break;
     case lf_lambda:
-        layer = lisp_args_overlay(exec, L_FN_ARGS(fn), args);
-        newenv = lisp_create_pair(layer, L_FN_ENV(fn));
+        layer = lisp_args_overlay(exec, fn, args);
+        newenv = s_call_env(exec, fn, layer);
         lisp_exec_push_env(exec, newenv);
-        result = lisp_eval(exec, L_FN_BODY(fn));
+        result = lisp_exec_code(exec, lisp_fn_code(exec, fn));
         lisp_exec_pop_env(exec);
+        lisp_region_release(exec, &mark);
         break;
     case lf_macro:
-        layer = lisp_args_overlay(exec, L_FN_ARGS(fn), args);
-        newenv = lisp_create_pair(layer, L_FN_ENV(fn));
-        lisp_exec_push_env(exec, newenv);
-        macrofn = lisp_eval(exec, L_FN_BODY(fn));
-        result = lisp_eval(exec, macrofn);
-        lisp_exec_pop_env(exec);
+        result = lisp_eval(exec, lisp_macro_expand(exec, fn, args));
         break;
     default:
         assert(0);
@@ -944,271 +1513,111 @@ lv_t *lisp_exec_fn(lexec_t *exec, lv_t *fn, lv_t *args) {
 }
 
 /**
- * evaluate an expression under let
+ * returned by node handlers and the vm in place of a value to
+ * ask the caller to continue with exec->tc_node instead of
+ * recursing, so tail positions run in constant C stack.
  */
-lv_t *lisp_let(lexec_t *exec, lv_t *args, lv_t *expr) {
-    lv_t *argp = args;
-    lv_t *newenv;
-    lv_t *result;
-
-    newenv = lisp_create_pair(lisp_create_hash(), exec->env);
-
-    rt_assert(args->type == l_null ||
-              args->type == l_pair, le_type,
-              "let arg type");
+lv_t lisp_tail_marker;
 
-    if(args->type == l_pair) {
-        /* walk through each element of the list,
-           evaling k/v pairs and assigning them
-           to an environment to run the expr in */
-        while(argp && L_CAR(argp)) {
-            rt_assert(c_list_length(L_CAR(argp)) == 2, le_arity,
-                      "let arg arity");
-            c_hash_insert(L_CAR(newenv), L_CAAR(argp),
-                          lisp_eval(exec, L_CADAR(argp)));
-            argp=L_CDR(argp);
-        }
-    }
+/**
+ * request a tail call of fn.  The arguments are bound when the
+ * call is entered by lisp_tail_enter.
+ */
+lv_t *lisp_tail_call(lexec_t *exec, lv_t *fn, lv_t *args) {
+    assert(exec && fn && args);
+    assert(L_FN_FTYPE(fn) == lf_lambda);
 
-    lisp_exec_push_env(exec, newenv);
-    result = lisp_eval(exec, expr);
-    lisp_exec_pop_env(exec);
+    exec->tc_fn = fn;
+    exec->tc_args = args;
+    exec->tc_node = NULL;
 
-    return result;
+    return LISP_TAIL;
 }
 
-lv_t *lisp_let_star(lexec_t *exec, lv_t *args, lv_t *expr) {
-    lv_t *argp = args;
-    lv_t *newenv;
-    lv_t *result;
+/**
+ * request that evaluation continue with node, in whatever
+ * environment is current
+ */
+lv_t *lisp_tail_node(lexec_t *exec, lnode_t *node) {
+    assert(exec && node);
 
-    newenv = lisp_create_pair(lisp_create_hash(), exec->env);
+    exec->tc_fn = NULL;
+    exec->tc_node = node;
 
-    rt_assert(args->type == l_null ||
-              args->type == l_pair, le_type,
-              "let arg type");
+    return LISP_TAIL;
+}
 
-    lisp_exec_push_env(exec, newenv);
+/**
+ * enter a pending tail request, returning the node to run next.
+ * A tail call replaces the frame of the caller: the env and
+ * eval stacks, and the frame region, are reset to where they
+ * were when the running trampoline was entered before the
+ * callee is pushed.
+ */
+lnode_t *lisp_tail_enter(lexec_t *exec, lstack_t *env_stack,
+                         lstack_t *eval_stack, lregion_t *region) {
+    lv_t *fn = exec->tc_fn;
+    lv_t *layer;
 
-    if(args->type == l_pair) {
-        /* walk through each element of the list,
-           evaling k/v pairs and assigning them
-           to an environment to run the expr in */
-        while(argp && L_CAR(argp)) {
-            rt_assert(c_list_length(L_CAR(argp)) == 2, le_arity,
-                      "let arg arity");
-            c_hash_insert(L_CAR(newenv), L_CAAR(argp),
-                          lisp_eval(exec, L_CADAR(argp)));
-            argp=L_CDR(argp);
-        }
-    }
+    if(!fn)
+        return exec->tc_node;
 
-    result = lisp_eval(exec, expr);
-    lisp_exec_pop_env(exec);
+    exec->tc_fn = NULL;
+    exec->env_stack = env_stack;
+    exec->eval_stack = eval_stack;
+    lisp_region_release(exec, region);
 
-    return result;
+    lisp_exec_push_eval(exec, fn);
+    layer = lisp_args_overlay(exec, fn, exec->tc_args);
+    exec->env = s_call_env(exec, fn, layer);
+
+    return lisp_fn_code(exec, fn);
 }
 
 /**
- * quasiquote a term
+ * expand a macro call.  The unevaluated argument forms are
+ * bound to the macro formals and the macro body is run in the
+ * macro environment.  The expansion is returned for the caller
+ * to evaluate in its own environment.
  */
-lv_t *lisp_quasiquote(lexec_t *exec, lv_t *v) {
-    lv_t *res;
-    lv_t *vptr;
-    lv_t *rptr;
-    lv_t *v2, *v2ptr;
-
-    /* strategy: walk through the list, expanding
-       unquote and unquote-splicing terms */
-    if(v->type == l_pair) {
-        if (L_CAR(v)->type == l_sym &&
-            !strcmp(L_SYM(L_CAR(v)), "unquote")) {
-            rt_assert(c_list_length(L_CDR(v)) == 1, le_arity,
-                      "unquote arity");
-            return lisp_eval(exec, L_CADR(v));
-        }
+lv_t *lisp_macro_expand(lexec_t *exec, lv_t *macro, lv_t *args) {
+    lv_t *layer, *newenv;
+    lv_t *result;
 
-        /* quasi-quote and unquote-splice stuff */
-        res = lisp_create_pair(NULL, NULL);
-        rptr = res;
-        vptr = v;
-        while(vptr && L_CAR(vptr)) {
-            if(L_CAR(vptr)->type == l_pair &&
-               L_CAAR(vptr)->type == l_sym &&
-               !strcmp(L_SYM(L_CAAR(vptr)), "unquote-splicing")) {
-                /* splice this into result */
-                rt_assert(c_list_length(L_CDAR(vptr)) == 1, le_arity,
-                          "unquote-splicing arity");
-
-                v2 = lisp_eval(exec, L_CAR(L_CDAR(vptr)));
-                rt_assert(v2->type == l_pair || v2->type == l_null, le_type,
-                          "unquote-splicing expects list");
-
-                if(v2->type != l_null) {
-                    v2ptr = v2;
-                    while(v2ptr && L_CAR(v2ptr)) {
-                        L_CAR(rptr) = L_CAR(v2ptr);
-                        v2ptr = L_CDR(v2ptr);
-                        if(v2ptr) {
-                            L_CDR(rptr) = lisp_create_pair(NULL, NULL);
-                            rptr = L_CDR(rptr);
-                        }
-                    }
-                }
-            } else {
-                L_CAR(rptr) = lisp_quasiquote(exec, L_CAR(vptr));
-            }
+    assert(exec && macro && args);
+    rt_assert(macro->type == l_fn && L_FN_FTYPE(macro) == lf_macro,
+              le_type, "not a macro");
 
-            vptr = L_CDR(vptr);
-            if(vptr) {
-                L_CDR(rptr) = lisp_create_pair(NULL, NULL);
-                rptr = L_CDR(rptr);
-            }
-        }
+    lisp_exec_push_eval(exec, macro);
+    layer = lisp_args_overlay(exec, macro, args);
+    newenv = lisp_create_pair(layer, L_FN_ENV(macro));
+    lisp_exec_push_env(exec, newenv);
+    result = lisp_exec_code(exec, lisp_fn_code(exec, macro));
+    lisp_exec_pop_env(exec);
+    lisp_exec_pop_eval(exec);
 
-        return res;
-    } else {
-        return v;
-    }
+    return result;
 }
 
-
 /**
  * evaluate a lisp value
  */
 lv_t *lisp_eval(lexec_t *exec, lv_t *v) {
-    lv_t *env;
-    lv_t *fn;
-    lv_t *args;
-    lv_t *result;
-    lv_t *a0, *a1, *a2, *a3;
-
     assert(exec);
 
-    if(v->type == l_sym) {
-        result = c_env_lookup(exec->env, v);
-        if(result)
-            return result;
-    } /* otherwise, return symbol... */
-
-    if(v->type != l_pair) {  // atom?
-        return v;
-    }
-
-    /* check for special forms and functions */
-
-    if(v->type == l_pair) {
-	/* test special forms first */
-	if(L_CAR(v)->type == l_sym) {
-            if(strcmp(L_SYM(L_CAR(v)), "quote") == 0) {
-		return lisp_quote(exec, L_CDR(v));
-            } else if(!strcmp(L_SYM(L_CAR(v)), "define")) {
-                rt_assert(c_list_length(L_CDR(v)) == 2, le_arity,
-                          "define arity");
-                result = lisp_eval(exec, L_CADDR(v));
-                if(!result->bound)
-                    result->bound = L_CADR(v);
-
-                return lisp_define(exec, L_CADR(v), result);
-            } else if(!strcmp(L_SYM(L_CAR(v)), "lambda")) {
-                rt_assert(c_list_length(L_CDR(v)) == 2, le_arity,
-                          "lambda arity");
-                result = lisp_create_lambda(exec, L_CADR(v), L_CADDR(v));
-                lisp_stamp_value(result, v->row, v->col, v->file);
-                return result;
-            } else if(!strcmp(L_SYM(L_CAR(v)), "defmacro")) {
-                rt_assert(c_list_length(L_CDR(v)) == 3, le_arity,
-                          "defmacro arity");
-                a1 = L_CADR(v);                  // name
-                a2 = L_CADDR(v);                 // lambda-list/formals
-                a3 = L_CADDDR(v);                // form
-
-                rt_assert(a1->type == l_sym, le_type,
-                          "defmacro wrong type for name");
-
-                return lisp_define(exec, a1, lisp_create_macro(exec, a2, a3));
-            } else if(!strcmp(L_SYM(L_CAR(v)), "begin")) {
-                rt_assert(L_CADR(v), le_arity, "begin arity");
-                return lisp_begin(exec, L_CDR(v));
-            } else if(!strcmp(L_SYM(L_CAR(v)), "quasiquote")) {
-                rt_assert(
-                    L_CDR(v)->type == l_null ||
-                    (L_CDR(v)->type == l_pair && c_list_length(L_CDR(v)) == 1),
-                    le_arity,
-                    "quasiquote arity");
-                return lisp_quasiquote(exec, L_CADR(v));
-            } else if(!strcmp(L_SYM(L_CAR(v)), "if")) {
-                rt_assert(c_list_length(L_CDR(v)) == 3, le_arity,
-                          "if arity");
-                a1 = lisp_eval(exec, L_CADR(v));  // expression
-                a2 = L_CADDR(v);                 // value if true
-                a3 = L_CADDDR(v);                // value if false
-
-                if(a1->type == l_bool && L_BOOL(a1) == 0)
-                    return lisp_eval(exec, a3);
-                return lisp_eval(exec, a2);
-            } else if(!strcmp(L_SYM(L_CAR(v)), "let")) {
-                rt_assert(c_list_length(L_CDR(v)) == 2, le_arity,
-                          "let arity");
-                a1 = L_CADR(v);                  // tuple assignment list
-                a2 = L_CADDR(v);                 // eval under let
-
-                return lisp_let(exec, a1, a2);
-            } else if(!strcmp(L_SYM(L_CAR(v)), "let*")) {
-                rt_assert(c_list_length(L_CDR(v)) == 2, le_arity,
-                          "let arity");
-                a1 = L_CADR(v);                  // tuple assignment list
-                a2 = L_CADDR(v);                 // eval under let
-
-                return lisp_let_star(exec, a1, a2);
-            }
-	}
-
-        /* otherwise, eval all the items, and execute */
-        result = lisp_map(exec, lisp_create_pair(lisp_create_native_fn(lisp_eval), v));
-
-        /* make sure it's a function */
-        fn = L_CAR(result);
-        args = L_CDR(result);
-
-        rt_assert(fn->type == l_fn, le_type, "eval a non-function");
-
-        if(!args)
-            args = lisp_create_null();
-
-        /* and go. */
-        return lisp_exec_fn(exec, fn, args);
-
-	/* /\* test symbols *\/ */
-	/* if(v->type == l_fn) */
-        /*     fn = v; */
-	/* else if(L_CAR(v)->type == l_sym) { */
-        /*     lv_t *tmp = c_env_lookup(env, L_CAR(v)); */
-        /*     rt_assert(tmp, le_lookup, "unknown function"); */
-        /*     rt_assert(tmp->type == l_fn, le_type, "eval a non-function"); */
-        /*     fn = tmp; */
-	/* } */
-
-        /* lv_t *eval_fn = lisp_create_native_fn(lisp_eval); */
-
-	/* /\* execute the function *\/ */
-        /* args = L_CDR(v); */
-        /* if(!args) */
-        /*     args = lisp_create_null(); */
-
-	/* return L_FN(fn)(env, lisp_map(env, c_make_list(eval_fn, args, NULL))); */
-    }
-
-    assert(0);
+    return lisp_exec_code(exec, lisp_analyze(exec, v));
 }
 
 /**
- * return a quoted expression
+ * run analyzed code on the engine selected for the context
  */
-lv_t *lisp_quote(lexec_t *exec, lv_t *v) {
-    assert(exec);
-    rt_assert(c_list_length(v) == 1, le_arity, "quote arity");
-    return L_CAR(v);
+lv_t *lisp_exec_code(lexec_t *exec, lnode_t *node) {
+    assert(exec && node);
+
+    if(exec->engine == en_vm)
+        return lisp_vm_exec(exec, node);
+
+    return lisp_exec_node(exec, node);
 }
 
 /**
@@ -1286,7 +1695,7 @@ lv_t *lisp_apply(lexec_t *exec, lv_t *v) {
     /* here we would check arity, and do arg fixups
      * (&rest, etc) */
 
-    return L_FN(fn)(exec, list);
+    return lisp_exec_fn(exec, fn, list);
 }
 
 /**
@@ -1305,7 +1714,7 @@ lv_t *null_environment(lexec_t *exec, lv_t *v) {
 lv_t *c_env_version(int version) {
     environment_list_t *current = s_env_prim;
     lv_t *p_layer = lisp_create_hash();
-    lv_t *newenv;
+    lv_t *newenv, *fn;
     char filename[40];
     lexec_t *exec;
 
@@ -1321,8 +1730,14 @@ lv_t *c_env_version(int version) {
 
     /* now, load up a primitive environment */
     while(current && current->name) {
-        c_hash_insert(p_layer, lisp_create_string(current->name),
-                      lisp_create_native_fn(current->fn));
+        fn = current->argv_fn ?
+            lisp_create_argv_fn(current->argv_fn, current->min_args,
+                                current->max_args) :
+            lisp_create_native_fn(current->fn, current->min_args,
+                                  current->max_args);
+        L_FN_PURE(fn) = current->pure;
+
+        c_hash_insert(p_layer, lisp_create_string(current->name), fn);
         current++;
     }
 
@@ -1334,23 +1749,78 @@ lv_t *c_env_version(int version) {
 }
 
 lv_t *lisp_define(lexec_t *exec, lv_t *sym, lv_t *v) {
+    lv_t *layer;
+    int result;
+
     assert(exec);
 
     /* this is probably not a good or completely safe
      * check of an environment */
     rt_assert(exec->env->type == l_pair &&
               L_CAR(exec->env) &&
-              L_CAR(exec->env)->type == l_hash, le_type,
+              (L_CAR(exec->env)->type == l_hash ||
+               L_CAR(exec->env)->type == l_frame), le_type,
               "Not a valid environment");
 
     rt_assert(sym->type == l_sym, le_type, "cannot define non-symbol");
 
-    rt_assert(c_hash_insert(L_CAR(exec->env), sym, v), le_internal,
-        "error inserting hash element");
+    layer = L_CAR(exec->env);
+    if(layer->type == l_frame)
+        result = c_frame_insert(layer, sym, v);
+    else
+        result = c_hash_insert(layer, sym, v);
+
+    rt_assert(result, le_internal, "error inserting hash element");
+
+    return lisp_create_null();
+}
+
+/**
+ * set! a symbol already bound somewhere in the environment,
+ * in the layer that binds it
+ */
+lv_t *lisp_set(lexec_t *exec, lv_t *sym, lv_t *v) {
+    lv_t *current, *layer;
+    int result;
+
+    assert(exec);
+    rt_assert(sym->type == l_sym, le_type, "cannot set! non-symbol");
+
+    for(current = exec->env; current; current = L_CDR(current)) {
+        layer = L_CAR(current);
+        if(layer->type == l_frame) {
+            if(c_frame_fetch(layer, sym)) {
+                result = c_frame_insert(layer, sym, v);
+                break;
+            }
+        } else if(c_hash_fetch(layer, sym)) {
+            result = c_hash_insert(layer, sym, v);
+            break;
+        }
+    }
+
+    rt_assert(current, le_lookup, "set! of unbound variable");
+    rt_assert(result, le_internal, "error inserting hash element");
 
     return lisp_create_null();
 }
 
+/**
+ * make a list from an array of argc items
+ */
+lv_t *c_array_to_list(int argc, lv_t **argv) {
+    lv_t *result = NULL;
+    int index;
+
+    if(!argc)
+        return lisp_create_null();
+
+    for(index = argc - 1; index >= 0; index--)
+        result = lisp_create_pair(argv[index], result);
+
+    return result;
+}
+
 /**
  * make a sequence of lv_t into a list, terminated by NULL
  */
@@ -1380,15 +1850,22 @@ lv_t *c_make_list(lv_t *item, ...) {
 
 lv_t *c_env_lookup(lv_t *env, lv_t *key) {
     lv_t *current;
+    lv_t *layer;
     lv_t *result;
 
     assert(env->type == l_pair &&
            L_CAR(env) &&
-           L_CAR(env)->type == l_hash);
+           (L_CAR(env)->type == l_hash || L_CAR(env)->type == l_frame));
 
     current=env;
     while(current) {
-        if((result = c_hash_fetch(L_CAR(current), key)))
+        layer = L_CAR(current);
+        if(layer->type == l_frame)
+            result = c_frame_fetch(layer, key);
+        else
+            result = c_hash_fetch(layer, key);
+
+        if(result)
             return result;
         current = L_CDR(current);
     }
@@ -1396,27 +1873,6 @@ lv_t *c_env_lookup(lv_t *env, lv_t *key) {
     return NULL;
 }
 
-/**
- * begin special form
- *
- * (begin (expr1 expr2 expr3))
- */
-lv_t *lisp_begin(lexec_t *exec, lv_t *v) {
-    lv_t *current;
-    lv_t *retval;
-
-    assert(exec);
-    rt_assert(v->type == l_pair, le_type, "cannot begin non-list");
-
-    current = v;
-    while(v && (L_CAR(v))) {
-        retval = lisp_eval(exec, L_CAR(v));
-        v = L_CDR(v);
-    }
-
-    return retval;
-}
-
 /**
  * eval a list of items, one after the other, returning the
  * value of the last eval
@@ -1432,7 +1888,7 @@ lv_t *c_sequential_eval(lexec_t *exec, lv_t *v) {
         return v;
 
     while(current && L_CAR(current)) {
-        result = lisp_eval(exec, L_CAR(current));
+        result = lisp_eval(exec, lisp_expand(exec, L_CAR(current)));
         current = L_CDR(current);
     }
 
@@ -1460,7 +1916,9 @@ lv_t *lisp_dup_item(lv_t *v) {
 
     switch(v->type) {
     case l_int:
-        r = lisp_create_int(0);
+        if(!L_INT_BIG(v))
+            return lisp_create_int(L_FIX(v));
+        r = lisp_create_bigint();
         mpz_set(L_INT(r), L_INT(v));
         return r;
     case l_rational:
@@ -1468,8 +1926,10 @@ lv_t *lisp_dup_item(lv_t *v) {
         mpq_set(L_RAT(r), L_RAT(v));
         return r;
     case l_float:
-        r = lisp_create_float(0.0);
-        mpfr_set(L_FLOAT(r), L_FLOAT(v), MPFR_ROUND_TYPE);
+        return lisp_create_float(L_FLOAT(v));
+    case l_bigfloat:
+        r = lisp_create_bigfloat(mpfr_get_prec(L_BIGFLOAT(v)));
+        mpfr_set(L_BIGFLOAT(r), L_BIGFLOAT(v), MPFR_ROUND_TYPE);
         return r;
     case l_bool:
         return v;
@@ -1492,6 +1952,7 @@ lv_t *lisp_dup_item(lv_t *v) {
     case l_err:
         return lisp_create_err(L_ERR(v));
     case l_hash:
+    case l_frame:
         /* FIXME: should really be a copy */
         return v;
     case l_pair:
@@ -1623,36 +2084,92 @@ void lisp_exec_pop_eval(lexec_t *exec) {
     lisp_exec_pop(exec, es_eval);
 }
 
+/**
+ * push a (before . after) pair of dynamic-wind thunks, whose
+ * after is run by continuations escaping past it
+ */
+void lisp_exec_push_wind(lexec_t *exec, lv_t *winder) {
+    assert(exec);
+    assert(winder);
+
+    lisp_exec_push(exec, es_wind, winder);
+}
+
+/**
+ * and the matching pop
+ */
+void lisp_exec_pop_wind(lexec_t *exec) {
+    assert(exec);
+    assert(exec->wind_stack);
+
+    lisp_exec_pop(exec, es_wind);
+}
+
 /**
  * reset an existing context for start of evaluation
  */
 void lisp_context_reset(lexec_t *exec) {
     exec->ex_stack = NULL;
     exec->eval_stack = NULL;
+    exec->wind_stack = NULL;
+    exec->conts = NULL;
     exec->exc = le_success;
     exec->msg = NULL;
 }
 
+/**
+ * run a top-level form, below exec->stack_base.  A continuation
+ * resumed later puts back the C stack from here down, as it was
+ * when the form was suspended, so rather than returning through
+ * that, the result is handed back with a jump to the current
+ * lisp_execute, which has the registers of its callers.
+ */
+static void __attribute__((noinline))
+s_execute_base(lexec_t *exec, lv_t *v, lv_t *volatile *presult,
+               jmp_buf *pdone) {
+    volatile char base;
+
+    if(!exec->stack_base)
+        exec->stack_base = (char *)&base;
+
+    *presult = c_sequential_eval(exec, v);
+    longjmp(*pdone, 1);
+}
+
 /**
  * top level exec
  */
 lv_t *lisp_execute(lexec_t *exec, lv_t *v) {
-    jmp_buf jb;
-    lv_t *result;
+    jmp_buf jb, done;
+    lv_t *volatile result;
+    lv_t *env = exec->env;
+    lstack_t *env_stack = exec->env_stack;
+    lregion_t region = exec->region;
+    char *stack_base = exec->stack_base;
 
     lisp_context_reset(exec);
 
     lisp_exec_push_ex(exec, &jb);
 
     if(setjmp(jb) == 0) {
-        result = c_sequential_eval(exec, v);
+        if(setjmp(done) == 0)
+            s_execute_base(exec, v, &result, &done);
+
+        exec->stack_base = stack_base;
         assert(exec->eval_stack == NULL);
         return result;
     }
 
+    exec->stack_base = stack_base;
+
     if(exec->ehandler)
         exec->ehandler(exec);
 
+    /* unwind whatever environments the error jumped out of */
+    exec->env = env;
+    exec->env_stack = env_stack;
+    lisp_region_release(exec, &region);
+
     return NULL;
 }
 
@@ -1686,8 +2203,6 @@ lv_t *p_error_objectp(lexec_t *exec, lv_t *v) {
     assert(exec && v);
     assert(v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 arg");
-
     lv_t *a0 = L_CAR(v);
 
     if(a0->type == l_err)
@@ -1704,8 +2219,6 @@ lv_t *c_error_type(lexec_t *exec, lv_t *v, lisp_errsubtype_t s) {
     assert(exec && v);
     assert(v->type == l_pair);
 
-    rt_assert(c_list_length(v) == 1, le_arity, "expecting 1 arg");
-
     lv_t *a0 = L_CAR(v);
 
     if((a0->type == l_err) && (L_ERR(a0) == s))
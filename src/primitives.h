@@ -38,12 +38,15 @@ extern char *safe_strdup(char *str);
  */
 extern lexec_t *lisp_context_new(int scheme_revision);
 extern void lisp_context_reset(lexec_t *exec);
+extern void lisp_set_engine(lexec_t *exec, lisp_engine_t engine);
 extern void lisp_exec_push_env(lexec_t *exec, lv_t *env);   // environment
 extern void lisp_exec_pop_env(lexec_t *exec);               // environment
 extern void lisp_exec_push_ex(lexec_t *exec, jmp_buf *pjb); // longjmp/exception
 extern void lisp_exec_pop_ex(lexec_t *exec);                // longjmp/exception
 extern void lisp_exec_push_eval(lexec_t *exec, lv_t *ev);   // eval context
 extern void lisp_exec_pop_eval(lexec_t *exec);              // eval context
+extern void lisp_exec_push_wind(lexec_t *exec, lv_t *winder); // dynamic-wind
+extern void lisp_exec_pop_wind(lexec_t *exec);              // dynamic-wind
 
 extern lv_t *lisp_execute(lexec_t *exec, lv_t *v);
 
@@ -56,16 +59,20 @@ extern lv_t *lisp_create_string(char *value);
 extern lv_t *lisp_create_symbol(char *value);
 extern lv_t *lisp_create_int(int64_t value);
 extern lv_t *lisp_create_int_str(char *value);
+extern lv_t *lisp_create_bigint(void);
 extern lv_t *lisp_create_rational(int64_t n, int64_t d);
 extern lv_t *lisp_create_rational_str(char *value);
 extern lv_t *lisp_create_float(double value);
 extern lv_t *lisp_create_float_str(char *value);
+extern lv_t *lisp_create_bigfloat(mpfr_prec_t prec);
 extern lv_t *lisp_create_char(char value);
 extern lv_t *lisp_create_bool(int value);
 extern lv_t *lisp_create_hash(void);
+extern lv_t *lisp_create_frame(lscope_t *scope);
 extern lv_t *lisp_create_null(void);
 extern lv_t *lisp_create_err(lisp_errsubtype_t value);
-extern lv_t *lisp_create_native_fn(lisp_method_t value);
+extern lv_t *lisp_create_native_fn(lisp_method_t value, int min_args, int max_args);
+extern lv_t *lisp_create_argv_fn(lisp_argv_method_t value, int min_args, int max_args);
 extern lv_t *lisp_create_port(port_info_t *pi);
 extern lv_t *lisp_create_lambda(lexec_t *exec, lv_t *formals, lv_t *body);
 extern lv_t *lisp_create_macro(lexec_t *exec, lv_t *formals, lv_t *form);
@@ -73,16 +80,59 @@ extern lv_t *lisp_create_formatted_string(char *fmt, ...)
     __attribute__((format (printf, 1, 2)));
 extern lv_t *lisp_wrap_type(char *symv, lv_t *v);
 
+/**
+ * ints, which are fixnums or bignums
+ */
+extern lv_t *lisp_int_normalize(lv_t *v);
+extern mpz_ptr lisp_int_mpz(lv_t *v, mpz_t tmp);
+extern int64_t lisp_int_get(lv_t *v);
+extern int lisp_int_cmp(lv_t *a, lv_t *b);
+extern int lisp_int_sgn(lv_t *v);
+
 /**
  * misc utilities
  */
 extern lv_t *lisp_parse_string(char *string);
 extern lv_t *lisp_parse_file(char *file);
 extern lv_t *lisp_exec_fn(lexec_t *exec, lv_t *fn, lv_t *args);
-extern lv_t *lisp_begin(lexec_t *exec, lv_t *v);
+extern lv_t *lisp_exec_argv(lexec_t *exec, lv_t *fn, int argc, lv_t **argv);
+extern void lisp_check_arity(lexec_t *exec, lv_t *fn, int argc);
+extern lv_t *lisp_macro_expand(lexec_t *exec, lv_t *macro, lv_t *args);
+
+/**
+ * tail calls
+ */
+extern lv_t lisp_tail_marker;
+#define LISP_TAIL (&lisp_tail_marker)
+
+/**
+ * #t, #f and () are always these, so they cost nothing to make
+ * and can be compared by pointer.  Chars are interned too.
+ */
+extern lv_t lisp_true_value;
+extern lv_t lisp_false_value;
+extern lv_t lisp_null_value;
+#define LISP_TRUE (&lisp_true_value)
+#define LISP_FALSE (&lisp_false_value)
+#define LISP_NULL (&lisp_null_value)
+
+extern lv_t *lisp_tail_call(lexec_t *exec, lv_t *fn, lv_t *args);
+extern lv_t *lisp_tail_node(lexec_t *exec, lnode_t *node);
+extern lnode_t *lisp_tail_enter(lexec_t *exec, lstack_t *env_stack,
+                                lstack_t *eval_stack, lregion_t *region);
+
+/**
+ * frame region
+ */
+extern void *lisp_region_alloc(lexec_t *exec, size_t size);
+extern void lisp_region_release(lexec_t *exec, lregion_t *mark);
+extern int lisp_region_contains(lexec_t *exec, void *ptr);
+extern void lisp_region_keep(lexec_t *exec);
+extern void lisp_region_pin(lexec_t *exec, lv_t *env);
 extern void lisp_stamp_value(lv_t *v, int row, int col, char *file);
+extern int lisp_value_pos(lv_t *v, int *row, int *col, char **file);
 extern lv_t *lisp_dup_item(lv_t *v);
-extern lv_t *lisp_args_overlay(lexec_t *exec, lv_t *formals, lv_t *args);
+extern lv_t *lisp_args_overlay(lexec_t *exec, lv_t *fn, lv_t *args);
 extern lv_t *lisp_get_kth(lv_t *v, int k);
 
 /**
@@ -91,9 +141,17 @@ extern lv_t *lisp_get_kth(lv_t *v, int k);
 extern lv_t *c_hash_fetch(lv_t *hash, lv_t *key);
 extern int c_hash_delete(lv_t *hash, lv_t *key);
 extern int c_hash_insert(lv_t *hash, lv_t *key, lv_t *value);
+extern lv_t **c_hash_cell(lv_t *hash, lv_t *key);
 extern lv_t *c_env_lookup(lv_t *env, lv_t *key);
+extern unsigned int lisp_env_version;
 extern void c_hash_walk(lv_t *hash, void(*callback)(lv_t *key, lv_t *value));
 
+/**
+ * frame utilities
+ */
+extern lv_t *c_frame_fetch(lv_t *frame, lv_t *key);
+extern int c_frame_insert(lv_t *frame, lv_t *key, lv_t *value);
+
 /**
  * error utilities
  */
@@ -108,6 +166,7 @@ extern lv_t *p_eof_errorp(lexec_t *exec, lv_t *v);
 extern void lisp_dump_value(int fd, lv_t *value, int level);
 extern int c_list_length(lv_t *v);
 extern lv_t *c_make_list(lv_t *item, ...);
+extern lv_t *c_array_to_list(int argc, lv_t **argv);
 extern lv_t *lisp_str_from_value(lexec_t *exec, lv_t *v, int display);
 extern int lisp_snprintf(lexec_t *exec, char *buf, int len, lv_t *v, int display);
 
@@ -115,6 +174,7 @@ extern int lisp_snprintf(lexec_t *exec, char *buf, int len, lv_t *v, int display
  * actual language items
  */
 extern lv_t *lisp_eval(lexec_t *exec, lv_t *v);
+extern lv_t *lisp_exec_code(lexec_t *exec, lnode_t *node);
 extern lv_t *lisp_map(lexec_t *exec, lv_t *v);
 extern lv_t *lisp_apply(lexec_t *exec, lv_t *v);
 extern lv_t *c_sequential_eval(lexec_t *exec, lv_t *v);
@@ -123,10 +183,8 @@ extern lv_t *c_sequential_eval(lexec_t *exec, lv_t *v);
 /**
  * special form helpers
  */
-extern lv_t *lisp_quote(lexec_t *exec, lv_t *v);
 extern lv_t *lisp_define(lexec_t *exec, lv_t *sym, lv_t *v);
-extern lv_t *lisp_quasiquote(lexec_t *exec, lv_t *v);
-extern lv_t *lisp_let(lexec_t *exec, lv_t *args, lv_t *expr);
+extern lv_t *lisp_set(lexec_t *exec, lv_t *sym, lv_t *v);
 
 /**
  * runtime asserts
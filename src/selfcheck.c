@@ -102,15 +102,38 @@ void print_test_result(result_t result) {
     printf("\n");
 }
 
+/**
+ * load a scheme test file into a fresh context running on
+ * the given engine
+ */
+lexec_t *load_scm_test(char *path, lisp_engine_t engine) {
+    lexec_t *exec;
+    char buffer[4096];
+
+    exec = lisp_context_new(5);
+    lisp_set_ehandler(exec, null_ehandler);
+    lisp_set_engine(exec, engine);
+
+    snprintf(buffer, sizeof(buffer), "(load \"%s\")", path);
+    c_sequential_eval(exec, c_parse_string(exec, buffer));
+
+    return exec;
+}
+
+/**
+ * run the scheme tests in testdir.  Every test is run on both
+ * the tree walker and the vm, and the engines must agree.
+ */
 int run_scm_tests(char *testdir) {
     DIR *d;
     lexec_t *exec;
-    lv_t *result;
+    lexec_t *vm_exec;
+    char path[4096];
     char buffer[4096];
     struct dirent *de;
     char *test;
     int success = 1;
-    int err;
+    int err, vm_err;
 
     d = opendir(testdir);
     if(!d) {
@@ -120,13 +143,10 @@ int run_scm_tests(char *testdir) {
 
     while((de = readdir(d))) {
         if((strlen(de->d_name) > 4) && (!strncasecmp(de->d_name, "test", 4))) {
-            exec = lisp_context_new(5);
-            lisp_set_ehandler(exec, null_ehandler);
-
-            snprintf(buffer, sizeof(buffer), "(load \"%s/%s\")",
-                     testdir, de->d_name);
+            snprintf(path, sizeof(path), "%s/%s", testdir, de->d_name);
 
-            c_sequential_eval(exec, c_parse_string(exec, buffer));
+            exec = load_scm_test(path, en_tree);
+            vm_exec = load_scm_test(path, en_vm);
 
             /* run through the environment, calling all the tests */
             void maybe_run_test(lv_t *l_n, lv_t *l_t) {
@@ -144,10 +164,19 @@ int run_scm_tests(char *testdir) {
                     snprintf(buffer, sizeof(buffer), "(%s)", test);
 
                     lisp_execute(exec, c_parse_string(exec, buffer));
-
                     err = exec->exc;
 
-                    if(err == 0) {
+                    lisp_execute(vm_exec, c_parse_string(vm_exec, buffer));
+                    vm_err = vm_exec->exc;
+
+                    if(err != vm_err) {
+                        print_test_result(FAIL);
+                        current_test = test;
+                        if(current_errors < MAX_ERRORS)
+                            enqueue_error("tree and vm engines disagree",
+                                          path, 0);
+                        success = 0;
+                    } else if(err == 0) {
                         print_test_result(SUCCESS);
                     } else if (err == le_warn) {
                         print_test_result(WARN);
@@ -7,13 +7,16 @@
 #include "lisp-types.h"
 #include "primitives.h"
 #include "selfcheck.h"
+#include "aot.h"
+#include "analyze.h"
+#include "math.h"
 
 int int_value(lv_t *v) {
-    return mpz_get_ui(L_INT(v));
+    return lisp_int_get(v);
 }
 
 double float_value(lv_t *v) {
-    return mpfr_get_d(L_FLOAT(v), MPFR_RNDN);
+    return L_FLOAT(v);
 }
 
 int test_special_forms_quote(void *scaffold) {
@@ -107,3 +110,224 @@ int test_equal(void *scaffold) {
 
     return 1;
 }
+
+int test_vm_engine(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    lisp_set_engine(exec, en_vm);
+
+    r = c_sequential_eval(exec, c_parse_string(exec, "(if #f 1 (+ 2 3))"));
+    assert(r->type == l_int);
+    assert(int_value(r) == 5);
+
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(define count (lambda (x) (if (= x 0) 0 (+ 1 (count (- x 1))))))"
+        "(let ((n 10)) (count n))"));
+    assert(r->type == l_int);
+    assert(int_value(r) == 10);
+
+    /* errors still come through the vm */
+    lisp_execute(exec, c_parse_string(exec, "(+ 1 (quote arf))"));
+    assert(exec->exc == le_type);
+
+    return 1;
+}
+
+int test_vm_deep_recursion(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    /* non-tail calls nest on the heap, not the C stack */
+    lisp_set_engine(exec, en_vm);
+
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(define build (lambda (n) (if (= n 0) (quote ())"
+        " (cons n (build (- n 1))))))"
+        "(define walk (lambda (l) (if (null? l) 0 (+ 1 (walk (cdr l))))))"
+        "(walk (build 200000))"));
+    assert(r->type == l_int);
+    assert(int_value(r) == 200000);
+
+    return 1;
+}
+
+int test_call_cc(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(define saved #f)"
+        "(+ 1 (call/cc (lambda (k) (begin (set! saved k) 1))))"));
+    assert(r->type == l_int);
+    assert(int_value(r) == 2);
+
+    /* one-shot: the call/cc has returned, and can't again */
+    lisp_execute(exec, c_parse_string(exec, "(saved 5)"));
+    assert(exec->exc == le_internal);
+
+    /* a call/cc jumped past is resumed from its copy, even from
+     * a later top-level form */
+    lisp_execute(exec, c_parse_string(
+        exec, "(define resume #f)"
+        "(define out #f)"
+        "(define step (lambda ()"
+        " (call/cc (lambda (o) (begin (set! out o)"
+        " (if resume (resume 5)"
+        " (let ((v (+ 100 (call/cc (lambda (k)"
+        " (begin (set! resume k) (o 1)))))))"
+        " (out v))))))))"));
+    r = lisp_execute(exec, c_parse_string(exec, "(step)"));
+    assert(r && int_value(r) == 1);
+
+    r = lisp_execute(exec, c_parse_string(exec, "(step)"));
+    assert(r && int_value(r) == 105);
+
+    return 1;
+}
+
+int test_math_site_feedback(void *scaffold) {
+    lv_t *r;
+    lnode_t *node;
+    lexec_t *exec = (lexec_t *)scaffold;
+    int index;
+
+    c_sequential_eval(exec, c_parse_string(exec, "(define sx 1)"));
+    node = lisp_analyze(exec, L_CAR(c_parse_string(exec, "(+ sx sx)")));
+
+    /* a site that has only seen ints is specialized for them */
+    for(index = 0; index < 10; index++)
+        r = lisp_exec_node(exec, node);
+    assert(int_value(r) == 2);
+    assert(node->site && node->site->kind == MS_INT);
+
+    /* and falls back when the guard fails */
+    c_sequential_eval(exec, c_parse_string(exec, "(set! sx 1.5)"));
+    r = lisp_exec_node(exec, node);
+    assert(r->type == l_float);
+    assert(float_value(r) == 3.0);
+
+    /* calls of other primitives get no site */
+    node = lisp_analyze(exec, L_CAR(c_parse_string(exec, "(cons sx sx)")));
+    lisp_exec_node(exec, node);
+    assert(!node->site);
+
+    return 1;
+}
+
+int test_fixnum(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    /* small ints stay fixnums */
+    r = c_sequential_eval(exec, c_parse_string(exec, "(+ 1 2)"));
+    assert(!L_INT_BIG(r) && L_FIX(r) == 3);
+
+    /* overflow promotes */
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(define b (* 4611686018427387904 4)) b"));
+    assert(L_INT_BIG(r));
+
+    /* and results that fit again are fixnums */
+    r = c_sequential_eval(exec, c_parse_string(exec, "(- b b)"));
+    assert(!L_INT_BIG(r) && L_FIX(r) == 0);
+
+    r = c_sequential_eval(exec, c_parse_string(exec, "9223372036854775808"));
+    assert(L_INT_BIG(r));
+
+    return 1;
+}
+
+int test_bigfloat(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    /* bigfloats keep the precision they were made with */
+    r = c_sequential_eval(exec, c_parse_string(exec, "(bigfloat 1 128)"));
+    assert(r->type == l_bigfloat);
+    assert(mpfr_get_prec(L_BIGFLOAT(r)) == 128);
+
+    /* and floats meeting them become bigfloats of that precision */
+    r = c_sequential_eval(exec, c_parse_string(exec, "(+ 0.5 (bigfloat 1 128))"));
+    assert(r->type == l_bigfloat);
+    assert(mpfr_get_prec(L_BIGFLOAT(r)) == 128);
+
+    r = c_sequential_eval(exec, c_parse_string(exec,
+                                               "(* (bigfloat 1 64) (bigfloat 2 256))"));
+    assert(mpfr_get_prec(L_BIGFLOAT(r)) == 256);
+
+    /* without one, it's plain doubles */
+    r = c_sequential_eval(exec, c_parse_string(exec, "(* 0.5 3)"));
+    assert(r->type == l_float);
+    assert(float_value(r) == 1.5);
+
+    return 1;
+}
+
+int test_singletons(void *scaffold) {
+    lv_t *r;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    /* #t, #f, () and chars are the same object however made */
+    assert(lisp_create_bool(1) == LISP_TRUE);
+    assert(lisp_create_bool(0) == LISP_FALSE);
+    assert(lisp_create_null() == LISP_NULL);
+    assert(lisp_create_char('a') == lisp_create_char('a'));
+
+    r = c_sequential_eval(exec, c_parse_string(exec, "(null? (quote ()))"));
+    assert(r == LISP_TRUE);
+    r = c_sequential_eval(exec, c_parse_string(exec, "(cdr (list 1))"));
+    assert(r == LISP_NULL);
+
+    r = c_sequential_eval(exec, c_parse_string(exec, "(equal? #t #f)"));
+    assert(r == LISP_FALSE);
+    r = c_sequential_eval(exec, c_parse_string(exec, "(equal? #\\a #\\a)"));
+    assert(r == LISP_TRUE);
+
+    return 1;
+}
+
+int test_flat_closure(void *scaffold) {
+    lv_t *r, *env;
+    lexec_t *exec = (lexec_t *)scaffold;
+
+    /* a closure keeps only the variables it uses */
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(let ((big (quote (1 2 3))) (x 2)) (lambda () x))"));
+    assert(r->type == l_fn);
+
+    env = L_FN_ENV(r);
+    assert(L_CAR(env)->type == l_frame);
+    assert(L_FRAME_COUNT(L_CAR(env)) == 1);
+    assert(int_value(L_FRAME_SLOT(L_CAR(env), 0)) == 2);
+    assert(L_CADR(env)->type == l_hash);
+
+    /* but shares the frame of a variable that is assigned */
+    r = c_sequential_eval(exec, c_parse_string(
+        exec, "(let ((big 1) (x 2)) (begin (set! x 3) (lambda () x)))"));
+    assert(r->type == l_fn);
+    assert(L_FRAME_COUNT(L_CAR(L_FN_ENV(r))) == 2);
+
+    return 1;
+}
+
+int test_aot_compile(void *scaffold) {
+    lexec_t *exec = (lexec_t *)scaffold;
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *out;
+
+    /* the define compiles, the closure over n is left as data */
+    out = open_memstream(&buf, &size);
+    assert(lisp_aot_compile(exec, c_parse_string(
+        exec, "(define sq (lambda (x) (* x x)))"
+        "(define adder (lambda (n) (lambda (x) (+ x n))))"), "t.scm", out));
+    fclose(out);
+
+    assert(strstr(buf, "1 of 2 top level"));
+    assert(strstr(buf, "static lv_t *s_code_0("));
+    assert(strstr(buf, "int main("));
+    free(buf);
+
+    return 1;
+}
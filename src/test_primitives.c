@@ -61,7 +61,32 @@ int test_environment(void *scaffold) {
     assert(fn == fn2);
 
     /* make sure it actually points to the right thing */
-    assert(L_FN(fn) == p_nullp);
+    assert(L_FN_ARGV(fn) == p_nullp);
+
+    return 1;
+}
+
+int test_value_positions(void *scaffold) {
+    lexec_t *exec = (lexec_t *)scaffold;
+    lv_t *form, *fn;
+    int row, col;
+    char *file;
+
+    /* a pair is the type word and two pointers */
+    assert(LV_SIZE(p) == offsetof(lv_t, value) + 2 * sizeof(lv_t *));
+
+    form = c_parse_string(exec, "(lambda (x) (+ x 1))");
+    assert(!lisp_value_pos(form, &row, &col, &file));
+
+    lisp_stamp_value(L_CADDR(L_CAR(form)), 3, 7, "test.scm");
+    assert(lisp_value_pos(L_CADDR(L_CAR(form)), &row, &col, &file));
+    assert(row == 3 && col == 7 && !strcmp(file, "test.scm"));
+
+    /* lambdas are found by their body */
+    fn = c_sequential_eval(exec, form);
+    assert(fn->type == l_fn);
+    assert(lisp_value_pos(fn, &row, &col, &file));
+    assert(row == 3 && col == 7);
 
     return 1;
 }
@@ -0,0 +1,139 @@
+;; continuations and dynamic-wind
+
+(define test-cont-return
+  (lambda ()
+    (begin
+      (assert (equal? 3 (call/cc (lambda (k) (+ 1 2)))))
+      (assert (equal? 5 (+ 1 (call/cc (lambda (k) (+ 10 (k 4))))))))))
+
+;; early exit from a search, out of deep non-tail recursion
+
+(define find-first
+  (lambda (pred l)
+    (call/cc
+     (lambda (return)
+       (let ((walk #f))
+         (begin
+           (set! walk (lambda (l)
+                        (if (null? l)
+                            (return #f)
+                            (if (pred (car l))
+                                (return (car l))
+                                (+ 0 (walk (cdr l)))))))
+           (walk l)))))))
+
+(define test-cont-search
+  (lambda ()
+    (begin
+      (assert (equal? 4 (find-first (lambda (x) (> x 3)) '(1 2 3 4 5))))
+      (assert (equal? #f (find-first (lambda (x) (> x 9)) '(1 2 3)))))))
+
+(define test-cont-long-name
+  (lambda ()
+    (assert (equal? 'out (call-with-current-continuation
+                          (lambda (k) (begin (k 'out) 'in)))))))
+
+;; the after thunk runs on the way out, normally or by escape
+
+(define wind-log '())
+(define wind-note (lambda (x) (set! wind-log (cons x wind-log))))
+
+(define test-cont-wind
+  (lambda ()
+    (begin
+      (set! wind-log '())
+      (assert (equal? 'during
+                      (dynamic-wind (lambda () (wind-note 'before))
+                                    (lambda () 'during)
+                                    (lambda () (wind-note 'after)))))
+      (assert (equal? '(after before) wind-log)))))
+
+(define test-cont-wind-escape
+  (lambda ()
+    (begin
+      (set! wind-log '())
+      (assert (equal? 'escaped
+                      (call/cc
+                       (lambda (k)
+                         (dynamic-wind (lambda () (wind-note 'before))
+                                       (lambda () (begin (k 'escaped) 'during))
+                                       (lambda () (wind-note 'after)))))))
+      (assert (equal? '(after before) wind-log)))))
+;; a generator: the walk is suspended by each escape out of it,
+;; and resumed by the next call.  Continuations are one-shot, so
+;; it always leaves by the latest return.
+
+(define make-gen
+  (lambda (l)
+    (let ((return #f) (resume #f))
+      (begin
+        (define walk
+          (lambda (l)
+            (if (null? l)
+                (return 'done)
+                (begin
+                  (call/cc (lambda (k)
+                             (begin (set! resume k) (return (car l)))))
+                  (walk (cdr l))))))
+        (lambda ()
+          (call/cc (lambda (r)
+                     (begin
+                       (set! return r)
+                       (if resume (resume #f) (walk l))))))))))
+
+(define test-cont-generator
+  (lambda ()
+    (let ((g (make-gen '(1 2 3))))
+      (assert (equal? '(1 2 3 done) (list (g) (g) (g) (g)))))))
+
+;; walks that don't recurse in tail position keep their frames
+(define make-tree-gen
+  (lambda (tree)
+    (let ((return #f) (resume #f))
+      (begin
+        (define walk
+          (lambda (t)
+            (if (null? t)
+                0
+                (if (pair? t)
+                    (+ (walk (car t)) (walk (cdr t)))
+                    (call/cc (lambda (k)
+                               (begin (set! resume k) (return t))))))))
+        (lambda ()
+          (call/cc (lambda (r)
+                     (begin
+                       (set! return r)
+                       (if resume
+                           (resume 1)
+                           (let ((n (walk tree)))
+                             (return (list 'leaves n))))))))))))
+
+(define test-cont-generator-deep
+  (lambda ()
+    (let ((g (make-tree-gen '((a b) (c (d))))))
+      (assert (equal? '(a b c d (leaves 4)) (list (g) (g) (g) (g) (g)))))))
+
+;; befores run again on the way back in
+
+(define test-cont-wind-reenter
+  (lambda ()
+    (let ((return #f) (resume #f))
+      (begin
+        (set! wind-log '())
+        (define first
+          (call/cc
+           (lambda (r)
+             (begin
+               (set! return r)
+               (dynamic-wind (lambda () (wind-note 'before))
+                             (lambda ()
+                               (let ((v (call/cc
+                                         (lambda (k)
+                                           (begin (set! resume k)
+                                                  (return 'out))))))
+                                 (return v)))
+                             (lambda () (wind-note 'after)))))))
+        (define second
+          (call/cc (lambda (r) (begin (set! return r) (resume 'in)))))
+        (assert (equal? '(out in) (list first second)))
+        (assert (equal? '(after before after before) wind-log))))))
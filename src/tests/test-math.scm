@@ -6,7 +6,72 @@
 (define test-math-fn-*-arity (lambda () (assert (equal? (*) 1))))
 (define test-math-fn-*-arity2 (lambda () (assert (equal? (* 2) 2))))
 
+; a site specialized for the types it has seen still takes others
+(define site-add (lambda (a b) (+ a b)))
+(define site-sub (lambda (a b) (- a b)))
+(define site-lt (lambda (a b) (< a b)))
+(define site-warm
+  (lambda (f a b n)
+    (if (= n 0) (f a b) (begin (f a b) (site-warm f a b (- n 1))))))
 
+(define test-math-site-int
+  (lambda ()
+    (begin
+      (assert (equal? 3 (site-warm site-add 1 2 20)))
+      (assert (equal? 4.0 (site-add 1.5 2.5)))
+      (assert (equal? 3.5 (site-add 1 2.5))))))
+(define test-math-site-float
+  (lambda ()
+    (begin
+      (assert (equal? 3.5 (site-warm site-sub 5.0 1.5 20)))
+      (assert (equal? 4 (site-sub 5 1))))))
+(define test-math-site-comp
+  (lambda ()
+    (begin
+      (assert (site-warm site-lt 1 2 20))
+      (assert (not (site-lt 2.5 1))))))
+
+
+
+;; fixnums overflow into bignums, and come back
+(define big 9223372036854775808)
+(define test-math-fix-add-over
+  (lambda () (assert (equal? big (+ 9223372036854775807 1)))))
+(define test-math-fix-sub-over
+  (lambda () (assert (equal? (- 0 big) (- -9223372036854775807 1 1 -1)))))
+(define test-math-fix-mul-over
+  (lambda () (assert (equal? big (* 4611686018427387904 2)))))
+(define test-math-fix-back
+  (lambda () (assert (equal? 9223372036854775807 (- big 1)))))
+(define test-math-fix-quotient-over
+  (lambda () (assert (equal? big (quotient (- 0 big) -1)))))
+(define test-math-fix-site-over
+  (lambda () (assert (equal? big (site-warm site-add 9223372036854775807 1 20)))))
+(define test-math-fix-compare
+  (lambda () (assert (< 9223372036854775807 big))))
+
+;; floats are doubles; bigfloats carry their own precision
+(define test-math-float-double
+  (lambda () (assert (= 0 (- (+ 1.0 0.0000000000000000001) 1)))))
+(define test-math-float-string
+  (lambda () (assert (equal? "0.5" (number->string (/ 1.0 2))))))
+(define test-math-float-trig
+  (lambda () (assert (= 0 (sin 0)))))
+(define test-math-bigfloat-type
+  (lambda ()
+    (begin
+      (assert (float? (bigfloat 1 128)))
+      (assert (inexact? (bigfloat 1 128)))
+      (assert (float? (* 3 (bigfloat 2 128)))))))
+(define test-math-bigfloat-prec
+  (lambda () (assert (not (= 0 (- (+ (bigfloat 1 200) 0.0000000000000000001) 1))))))
+(define test-math-bigfloat-compare
+  (lambda ()
+    (begin
+      (assert (= (bigfloat 0.5 64) 1/2))
+      (assert (< 0.25 (bigfloat 0.5 64))))))
+(define test-math-bigfloat-round
+  (lambda () (assert (equal? -5 (floor (bigfloat -4.3 64))))))
 
 ;; modulo and remainder remainder
 (define test-math-mr-i-m-pnpd (lambda () (assert (equal? 1 (modulo 13 4)))))
@@ -17,6 +82,8 @@
 (define test-math-mr-i-r-pnnd (lambda () (assert (equal? 1 (remainder 13 -4)))))
 (define test-math-mr-i-m-nnnd (lambda () (assert (equal? -1 (modulo -13 -4)))))
 (define test-math-mr-i-r-nnnd (lambda () (assert (equal? -1 (remainder -13 -4)))))
+(define test-math-mr-i-m-exact (lambda () (assert (equal? 0 (modulo 8 -4)))))
+(define test-math-mr-b-m (lambda () (assert (equal? 2 (modulo (* big 4) 5)))))
 
 ;; trunc/round/ceiling/floor
 (define test-math-floor-fn (lambda () (assert (equal? -5 (floor -4.3)))))
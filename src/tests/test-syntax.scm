@@ -0,0 +1,408 @@
+;; special forms
+
+(define test-syntax-if-true (lambda () (assert (equal? 1 (if #t 1 2)))))
+(define test-syntax-if-false (lambda () (assert (equal? 2 (if #f 1 2)))))
+(define test-syntax-if-nonbool (lambda () (assert (equal? 1 (if '() 1 2)))))
+
+(define test-syntax-begin
+  (lambda ()
+    (assert (equal? 3 (begin 1 2 3)))))
+
+(define test-syntax-let
+  (lambda ()
+    (assert (equal? 3 (let ((a 1) (b 2)) (+ a b))))))
+
+(define test-syntax-let-star
+  (lambda ()
+    (assert (equal? 3 (let* ((a 1) (b (+ a 1))) (+ a b))))))
+
+(define test-syntax-internal-define-mutual
+  (lambda ()
+    (let ((g (lambda (n)
+               (begin
+                 (define ev? (lambda (n) (if (= n 0) #t (od? (- n 1)))))
+                 (define od? (lambda (n) (if (= n 0) #f (ev? (- n 1)))))
+                 (ev? n)))))
+      (begin
+        (assert (equal? #t (g 10)))
+        (assert (equal? #f (g 7)))))))
+
+(define test-syntax-let-star-rebind
+  (lambda ()
+    (begin
+      (assert (equal? 2 (let* ((x 1) (x (+ x 1))) x)))
+      (assert (equal? 6 (let* ((x 1) (y x) (x (+ x 2)) (x (* x 2))) x))))))
+
+(define test-syntax-quasiquote
+  (lambda ()
+    (assert (equal? '(1 2 3)
+                    (quasiquote (1 (unquote (+ 1 1)) 3))))))
+
+(define test-syntax-quasiquote-splice
+  (lambda ()
+    (assert (equal? '(1 2 3 4)
+                    (quasiquote (1 (unquote-splicing (list 2 3)) 4))))))
+
+(defmacro swap-args (f a b) (list f b a))
+
+(define test-syntax-defmacro
+  (lambda ()
+    (assert (equal? 1 (swap-args - 1 2)))))
+
+(define test-syntax-defmacro-caller-env
+  (lambda ()
+    (let ((x 5))
+      (assert (equal? 3 (swap-args - 2 x))))))
+
+(define expansions 0)
+(defmacro counted (x) (begin (set! expansions (+ expansions 1)) x))
+(define use-counted (lambda (x) (counted x)))
+
+(define test-syntax-defmacro-memoized
+  (lambda ()
+    (begin
+      (use-counted 1)
+      (use-counted 2)
+      (assert (equal? '(3 1) (list (use-counted 3) expansions))))))
+
+(define dynamic-expansions 0)
+(defmacro dynamic-counted (x)
+  (begin (set! dynamic-expansions (+ dynamic-expansions 1)) x))
+(dynamic-macro dynamic-counted)
+(define use-dynamic (lambda (x) (dynamic-counted x)))
+
+(define test-syntax-defmacro-dynamic
+  (lambda ()
+    (begin
+      (use-dynamic 1)
+      (use-dynamic 2)
+      (assert (equal? 2 dynamic-expansions)))))
+
+(defmacro redefined-macro (x) (list '+ x 1))
+(define use-redefined (lambda () (redefined-macro 1)))
+(define before-macro-redefine (use-redefined))
+(defmacro redefined-macro (x) (list '+ x 2))
+
+;; uses are expanded when the form is loaded, so a later
+;; redefinition does not reach them
+(define test-syntax-defmacro-redefine
+  (lambda ()
+    (assert (equal? '(2 2) (list before-macro-redefine (use-redefined))))))
+
+(define test-syntax-expand
+  (lambda ()
+    (assert (equal? '(- 2 1) (expand '(swap-args - 1 2))))))
+
+(define test-syntax-expand-nested
+  (lambda ()
+    (assert (equal? '(lambda (x) (if x (- 2 1) '(swap-args - 1 2)))
+                    (expand '(lambda (x) (if x (swap-args - 1 2)
+                                             '(swap-args - 1 2))))))))
+
+(define test-syntax-expand-shadowed
+  (lambda ()
+    (assert (equal? '(lambda (swap-args) (swap-args - 1 2))
+                    (expand '(lambda (swap-args) (swap-args - 1 2)))))))
+
+;; lexical scope
+
+(define test-syntax-scope-shadow
+  (lambda ()
+    (let ((x 1))
+      (let ((x 2) (y x))
+        (assert (equal? 3 (+ x y)))))))
+
+(define test-syntax-scope-let-star-outer
+  (lambda ()
+    (let ((x 1))
+      (let* ((x (+ x 1)) (y x))
+        (assert (equal? 4 (+ x y)))))))
+
+(define test-syntax-scope-closure
+  (lambda ()
+    (let ((make-adder (lambda (n) (lambda (x) (let ((y x)) (+ n y))))))
+      (assert (equal? 7 ((make-adder 3) 4))))))
+
+(define test-syntax-scope-rest
+  (lambda ()
+    (begin
+      (assert (equal? '(2 3) ((lambda (a . rest) rest) 1 2 3)))
+      (assert (equal? '(1 2) ((lambda args args) 1 2))))))
+
+(define test-syntax-scope-internal-define
+  (lambda ()
+    (let ((x 1))
+      (begin
+        (define x 5)
+        (define y (+ x 1))
+        (assert (equal? 11 (+ x y)))))))
+
+(define test-syntax-scope-macro-local
+  (lambda ()
+    (let ((a 1) (b 10))
+      (assert (equal? 9 (swap-args - a b))))))
+
+;; globals
+
+(define call-later (lambda () (defined-later 2)))
+(define defined-later (lambda (x) (+ x 1)))
+
+(define test-syntax-global-forward
+  (lambda ()
+    (assert (equal? 3 (call-later)))))
+
+(define redefined (lambda () 1))
+(define call-redefined (lambda () (redefined)))
+(define before-redefine (call-redefined))
+(define redefined (lambda () 2))
+
+(define test-syntax-global-redefine
+  (lambda ()
+    (assert (equal? '(1 2) (list before-redefine (call-redefined))))))
+
+(define cache-probe (lambda () (car '(1))))
+
+(define test-syntax-global-cache-stats
+  (lambda ()
+    (let ((before (begin (cache-probe) (cache-stats))))
+      (begin
+        (cache-probe)
+        (assert (> (car (cache-stats)) (car before)))))))
+
+;; cond, and, or, case, set!, do
+
+(define classify
+  (lambda (n)
+    (cond ((< n 0) 'negative)
+          ((= n 0) 'zero)
+          (else 'positive))))
+
+(define test-syntax-cond
+  (lambda ()
+    (assert (equal? '(negative zero positive)
+                    (list (classify -1) (classify 0) (classify 1))))))
+
+(define test-syntax-cond-test-only
+  (lambda ()
+    (assert (equal? 3 (cond (#f 1) ((+ 1 2)) (else 4))))))
+
+(define test-syntax-cond-arrow
+  (lambda ()
+    (assert (equal? 2 (cond ((car '(1)) => (lambda (x) (+ x 1)))
+                            (else 0))))))
+
+(define test-syntax-and
+  (lambda ()
+    (assert (equal? '(#t 3 #f) (list (and) (and 1 2 3) (and 1 #f 3))))))
+
+(define test-syntax-or
+  (lambda ()
+    (assert (equal? '(#f 1 2) (list (or) (or 1 2) (or #f 2))))))
+
+(define size
+  (lambda (n)
+    (case n
+      ((1 2 3) 'small)
+      ((10 20) 'big)
+      (else 'other))))
+
+(define test-syntax-case
+  (lambda ()
+    (assert (equal? '(small big other) (list (size 2) (size 20) (size 7))))))
+
+(define counter 0)
+
+(define test-syntax-set-global
+  (lambda ()
+    (begin
+      (set! counter (+ counter 1))
+      (set! counter (+ counter 1))
+      (assert (equal? 2 counter)))))
+
+(define test-syntax-set-local
+  (lambda ()
+    (let ((x 1))
+      (begin
+        (set! x 5)
+        (assert (equal? 5 x))))))
+
+(define make-counter
+  (lambda ()
+    (let ((n 0))
+      (lambda () (begin (set! n (+ n 1)) n)))))
+
+(define test-syntax-set-closure
+  (lambda ()
+    (let ((c (make-counter)))
+      (begin
+        (c)
+        (c)
+        (assert (equal? 3 (c)))))))
+
+(define test-syntax-do
+  (lambda ()
+    (assert (equal? 120 (do ((i 1 (+ i 1))
+                             (acc 1 (* acc i)))
+                            ((> i 5) acc))))))
+
+(define test-syntax-do-body
+  (lambda ()
+    (let ((total 0))
+      (begin
+        (do ((i 0 (+ i 1)))
+            ((= i 4))
+          (set! total (+ total i)))
+        (assert (equal? 6 total))))))
+
+;; constant folding
+
+(define test-syntax-fold
+  (lambda ()
+    (assert (equal? 86400 (* 60 60 24)))))
+
+(define test-syntax-fold-nested
+  (lambda ()
+    (assert (equal? 3697 (+ (* 60 60) (char->integer #\a))))))
+
+(define test-syntax-fold-quoted
+  (lambda ()
+    (assert (equal? '(2 3) (cdr '(1 2 3))))))
+
+;; errors are left to the call, not raised when it is loaded
+(define fold-error (lambda () (car 1)))
+
+(define fold-op +)
+(define use-fold-op (lambda () (fold-op 1 2)))
+(define before-fold-rebind (use-fold-op))
+(define fold-op -)
+
+(define test-syntax-fold-rebind
+  (lambda ()
+    (assert (equal? '(3 -1) (list before-fold-rebind (use-fold-op))))))
+
+(define fold-inner *)
+(define use-fold-inner (lambda () (+ 1 (fold-inner 2 3))))
+(define before-fold-inner-rebind (use-fold-inner))
+(define fold-inner +)
+
+(define test-syntax-fold-rebind-inner
+  (lambda ()
+    (assert (equal? '(7 6) (list before-fold-inner-rebind
+                                 (use-fold-inner))))))
+
+(define fold-macro quotient)
+(define use-fold-macro (lambda () (fold-macro 7 2)))
+(define before-fold-macro-rebind (use-fold-macro))
+(defmacro fold-macro (a b) 99)
+(define after-fold-macro-rebind (use-fold-macro))
+
+(define test-syntax-fold-rebind-macro
+  (lambda ()
+    (assert (equal? '(3 99 99) (list before-fold-macro-rebind
+                                     after-fold-macro-rebind
+                                     (use-fold-macro))))))
+
+;; inlined primitives
+
+(define inline-op car)
+(define use-inline-op (lambda (x) (inline-op x)))
+(define before-inline-rebind (use-inline-op '(1 2)))
+(define inline-op cdr)
+
+(define test-syntax-inline-rebind
+  (lambda ()
+    (assert (equal? '(1 (2)) (list before-inline-rebind
+                                   (use-inline-op '(1 2)))))))
+
+(define test-syntax-inline-mixed
+  (lambda ()
+    (let ((x 1) (y 2.5))
+      (assert (equal? '(3.5 #t -1.5) (list (+ x y) (< x y) (- x y)))))))
+
+(define test-syntax-inline-list
+  (lambda ()
+    (let ((x (cons 1 '())))
+      (assert (equal? '(1 () #t #f) (list (car x) (cdr x)
+                                          (null? (cdr x)) (pair? (car x))))))))
+
+;; closures
+
+(define test-syntax-closure-nested
+  (lambda ()
+    (assert (equal? '(1 2 3)
+                    ((((lambda (a) (lambda (b) (lambda (c) (list a b c))))
+                       1) 2) 3)))))
+
+(define test-syntax-closure-let-star
+  (lambda ()
+    (let* ((f (lambda () b)) (b 2))
+      (assert (equal? 2 (f))))))
+
+(define test-syntax-closure-internal-define
+  (lambda ()
+    (begin
+      (define y 5)
+      (assert (equal? 5 ((lambda () y)))))))
+
+(define test-syntax-closure-macro
+  (lambda ()
+    (let ((a 1) (b 2))
+      (assert (equal? -1 ((lambda () (swap-args - b a))))))))
+;; a closure with a call that may only turn out to be a macro use
+;; as it runs keeps the frames the expansion may look in
+
+(defmacro closure-late-y () 'y)
+(dynamic-macro closure-late-y)
+
+(define test-syntax-closure-dynamic-macro
+  (lambda ()
+    (let ((h (lambda (y) (lambda () (closure-late-y)))))
+      (assert (equal? 7 ((h 7)))))))
+
+(define closure-before-macro (lambda (y) (lambda () (closure-later-y))))
+(defmacro closure-later-y () 'y)
+
+(define test-syntax-closure-later-macro
+  (lambda ()
+    (assert (equal? 8 ((closure-before-macro 8))))))
+
+(define test-syntax-closure-later-define
+  (lambda ()
+    (let ((f (lambda ()
+               (begin
+                 (define g (lambda () v))
+                 (define v 3)
+                 (g)))))
+      (assert (equal? 3 (f))))))
+
+;; frames that escape through a macro expanded as the code runs
+;; are kept out of the frame region
+
+(defmacro make-counter-of (v)
+  (list 'lambda '() (list 'begin (list 'set! v (list '+ v 1)) v)))
+(dynamic-macro make-counter-of)
+(define counter-of (lambda (x) (let* ((y x)) (make-counter-of y))))
+(define sum-of (lambda (a b c) (+ a (+ b c))))
+
+(define test-syntax-region-pin
+  (lambda ()
+    (let ((c (counter-of 5)))
+      (begin
+        (sum-of 100 200 300)
+        (c)
+        (assert (equal? 7 (c)))))))
+
+;; each non-tail call is one backtrace entry, a tail call replaces
+;; its caller's
+
+(define bt-depth
+  (lambda (n)
+    (if (= n 0) (length (backtrace)) (+ 0 (bt-depth (- n 1))))))
+(define bt-tail (lambda (n) (if (= n 0) (backtrace) (bt-tail (- n 1)))))
+
+(define test-syntax-backtrace
+  (lambda ()
+    (begin
+      (assert (equal? 10 (- (bt-depth 10) (bt-depth 0))))
+      (assert (equal? bt-tail (car (bt-tail 5))))
+      (assert (equal? (length (bt-tail 0)) (length (bt-tail 5)))))))
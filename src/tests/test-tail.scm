@@ -0,0 +1,61 @@
+;; tail calls -- these loops run far deeper than the C stack would allow
+
+(define count-down
+  (lambda (n)
+    (if (= n 0)
+        'done
+        (count-down (- n 1)))))
+
+(define test-tail-if
+  (lambda ()
+    (assert (equal? 'done (count-down 100000)))))
+
+(define count-begin
+  (lambda (n acc)
+    (begin
+      (+ n 1)
+      (if (= n 0)
+          acc
+          (count-begin (- n 1) (+ acc 1))))))
+
+(define test-tail-begin
+  (lambda ()
+    (assert (equal? 100000 (count-begin 100000 0)))))
+
+(define count-let
+  (lambda (n)
+    (let ((m (- n 1)))
+      (let* ((k m) (j k))
+        (if (< j 0)
+            'done
+            (count-let j))))))
+
+(define test-tail-let
+  (lambda ()
+    (assert (equal? 'done (count-let 100000)))))
+
+(define ping (lambda (n) (if (= n 0) 'ping (pong (- n 1)))))
+(define pong (lambda (n) (if (= n 0) 'pong (ping (- n 1)))))
+
+(define test-tail-mutual
+  (lambda ()
+    (assert (equal? 'ping (ping 100000)))))
+
+(defmacro my-if (c a b) (list 'if c a b))
+
+(define count-macro
+  (lambda (n)
+    (my-if (= n 0)
+           'done
+           (count-macro (- n 1)))))
+
+(define test-tail-macro
+  (lambda ()
+    (assert (equal? 'done (count-macro 100000)))))
+
+(define test-tail-env-restored
+  (lambda ()
+    (let ((x 1))
+      (begin
+        (count-let 10)
+        (assert (equal? x 1))))))
@@ -0,0 +1,797 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "lisp-types.h"
+#include "primitives.h"
+#include "analyze.h"
+#include "builtins.h"
+#include "math.h"
+#include "vm.h"
+
+#define C(x) #x,
+char *lisp_ops_list[] = { LISP_OPS "op_max" };
+#undef C
+
+/* primitives run in line by op_inline, with their arg count */
+#define LISP_INLINES \
+    I(li_car, p_car, 1) \
+    I(li_cdr, p_cdr, 1) \
+    I(li_cons, p_cons, 2) \
+    I(li_nullp, p_nullp, 1) \
+    I(li_pairp, p_pairp, 1) \
+    I(li_add, p_plus, 2) \
+    I(li_sub, p_minus, 2) \
+    I(li_mul, p_mul, 2) \
+    I(li_eq, p_eq, 2) \
+    I(li_lt, p_lt, 2) \
+    I(li_gt, p_gt, 2) \
+    I(li_lte, p_lte, 2) \
+    I(li_gte, p_gte, 2)
+
+#define I(x, fn, argc) x,
+typedef enum lisp_inline_t { LISP_INLINES li_max } lisp_inline_t;
+#undef I
+
+static struct {
+    lisp_argv_method_t fn;
+    int argc;
+} s_inlines[] = {
+#define I(x, fn, argc) { fn, argc },
+    LISP_INLINES
+#undef I
+};
+
+/* compiler state */
+typedef struct lcomp_t {
+    lcode_t *code;
+    int size;       // allocated ops
+    int csize;      // allocated consts
+    int nsize;      // allocated nodes
+    int depth;      // current operand stack depth
+} lcomp_t;
+
+/**
+ * make room for one more item in a growable array
+ */
+static void *s_grow(void *ptr, int count, int *size, size_t item_size) {
+    void *pnew;
+
+    if(count < *size)
+        return ptr;
+
+    *size = *size ? *size * 2 : 16;
+    pnew = safe_malloc(*size * item_size);
+    if(ptr)
+        memcpy(pnew, ptr, count * item_size);
+
+    return pnew;
+}
+
+static int s_emit(lcomp_t *c, int op) {
+    lcode_t *code = c->code;
+
+    code->ops = s_grow(code->ops, code->len, &c->size, sizeof(int));
+    code->ops[code->len] = op;
+    return code->len++;
+}
+
+static int s_add_const(lcomp_t *c, lv_t *v) {
+    lcode_t *code = c->code;
+    int index;
+
+    for(index = 0; index < code->nconsts; index++)
+        if(code->consts[index] == v)
+            return index;
+
+    code->consts = s_grow(code->consts, code->nconsts,
+                          &c->csize, sizeof(lv_t *));
+    code->consts[code->nconsts] = v;
+    return code->nconsts++;
+}
+
+static int s_add_node(lcomp_t *c, lnode_t *node) {
+    lcode_t *code = c->code;
+
+    code->nodes = s_grow(code->nodes, code->nnodes,
+                         &c->nsize, sizeof(lnode_t *));
+    code->nodes[code->nnodes] = node;
+    return code->nnodes++;
+}
+
+static void s_stack(lcomp_t *c, int delta) {
+    c->depth += delta;
+    assert(c->depth >= 0);
+
+    if(c->depth > c->code->depth)
+        c->code->depth = c->depth;
+}
+
+static void s_compile(lexec_t *exec, lcomp_t *c, lnode_t *node, int tail);
+
+/**
+ * and/or: each term but the last jumps to the end with its value
+ * if it settles the result, or is popped
+ */
+static void s_compile_logical(lexec_t *exec, lcomp_t *c,
+                              lnode_t *node, int tail) {
+    int patch[node->argc];
+    int index;
+
+    for(index = 0; index < node->argc - 1; index++) {
+        s_compile(exec, c, node->argv[index], 0);
+        s_emit(c, node->type == ln_and ? op_jumpf_keep : op_jumpt_keep);
+        patch[index] = s_emit(c, 0);
+        s_stack(c, -1);
+    }
+
+    s_compile(exec, c, node->argv[node->argc - 1], tail);
+
+    for(index = 0; index < node->argc - 1; index++)
+        c->code->ops[patch[index]] = c->code->len;
+}
+
+/**
+ * case: op_case is followed by a jump table with an entry for
+ * each clause, and entry 0 for no match
+ */
+static void s_compile_case(lexec_t *exec, lcomp_t *c,
+                           lnode_t *node, int tail) {
+    int patch[node->argc];
+    int index, table;
+
+    s_compile(exec, c, node->argv[0], 0);
+    s_emit(c, op_case);
+    s_emit(c, s_add_node(c, node));
+    s_stack(c, -1);
+
+    table = c->code->len;
+    for(index = 0; index < node->argc; index++)
+        s_emit(c, 0);
+
+    for(index = 1; index < node->argc; index++) {
+        c->code->ops[table + index] = c->code->len;
+        s_compile(exec, c, node->argv[index], tail);
+        s_stack(c, -1);
+
+        if(tail) {
+            s_emit(c, op_return);
+        } else {
+            s_emit(c, op_jump);
+            patch[index] = s_emit(c, 0);
+        }
+    }
+
+    c->code->ops[table] = c->code->len;
+    s_emit(c, op_const);
+    s_emit(c, s_add_const(c, lisp_create_null()));
+    s_stack(c, 1);
+
+    if(!tail)
+        for(index = 1; index < node->argc; index++)
+            c->code->ops[patch[index]] = c->code->len;
+}
+
+/**
+ * do: the loop runs the test, then the commands and steps, and
+ * jumps back with the steps bound in place of the variables
+ */
+static void s_compile_do(lexec_t *exec, lcomp_t *c,
+                         lnode_t *node, int tail) {
+    int count = (node->argc - 3) / 2;
+    int index, loop, patch, patch_end;
+
+    for(index = 0; index < count; index++)
+        s_compile(exec, c, node->argv[3 + index], 0);
+
+    s_emit(c, op_let);
+    s_emit(c, s_add_node(c, node));
+    s_stack(c, -count);
+
+    loop = c->code->len;
+    s_compile(exec, c, node->argv[0], 0);
+    s_emit(c, op_jumpf);
+    patch = s_emit(c, 0);
+    s_stack(c, -1);
+
+    s_compile(exec, c, node->argv[1], tail);
+    if(tail) {
+        s_emit(c, op_return);
+    } else {
+        s_emit(c, op_jump);
+        patch_end = s_emit(c, 0);
+    }
+    s_stack(c, -1);
+
+    c->code->ops[patch] = c->code->len;
+    s_compile(exec, c, node->argv[2], 0);
+    s_emit(c, op_pop);
+    s_stack(c, -1);
+
+    for(index = 0; index < count; index++)
+        s_compile(exec, c, node->argv[3 + count + index], 0);
+
+    s_emit(c, op_rebind);
+    s_emit(c, s_add_node(c, node));
+    s_stack(c, -count);
+    s_emit(c, op_jump);
+    s_emit(c, loop);
+
+    /* the result is left on the stack */
+    s_stack(c, 1);
+    if(!tail) {
+        c->code->ops[patch_end] = c->code->len;
+        s_emit(c, op_pop_env);
+    }
+}
+
+/**
+ * find the primitive a call can be run in line as, or -1.  The
+ * operator has to be a global bound to one of the inlined
+ * primitives now, and op_inline checks it still is when it runs.
+ */
+static int s_inline_find(lexec_t *exec, lnode_t *node) {
+    lv_t *fn;
+    int index;
+
+    if(node->body->type != ln_global)
+        return -1;
+
+    fn = lisp_static_global(exec, node->body);
+    if(!fn || fn->type != l_fn || L_FN_FTYPE(fn) != lf_native)
+        return -1;
+
+    for(index = 0; index < li_max; index++)
+        if(L_FN_ARGV(fn) == s_inlines[index].fn &&
+           node->argc == s_inlines[index].argc)
+            return index;
+
+    return -1;
+}
+
+/**
+ * compile a call, expanding it instead if the operator turns
+ * out to be a macro
+ */
+static void s_compile_apply(lexec_t *exec, lcomp_t *c, lnode_t *node) {
+    int index, patch, inline_op;
+
+    s_compile(exec, c, node->body, 0);
+    s_emit(c, op_macro_check);
+    s_emit(c, s_add_node(c, node));
+    patch = s_emit(c, 0);
+
+    for(index = 0; index < node->argc; index++)
+        s_compile(exec, c, node->argv[index], 0);
+
+    if((inline_op = s_inline_find(exec, node)) != -1) {
+        s_emit(c, op_inline);
+        s_emit(c, inline_op);
+        s_emit(c, s_add_node(c, node));
+    } else {
+        s_emit(c, op_call);
+        s_emit(c, node->argc);
+    }
+    s_stack(c, -node->argc);
+
+    c->code->ops[patch] = c->code->len;
+}
+
+/**
+ * compile a node, leaving its value on the operand stack.  A
+ * node in tail position is followed by op_return, which is what
+ * makes a call a tail call at runtime.
+ */
+static void s_compile(lexec_t *exec, lcomp_t *c, lnode_t *node, int tail) {
+    lnode_t *sub;
+    int index, patch, patch_end;
+
+    switch(node->type) {
+    case ln_const:
+        s_emit(c, op_const);
+        s_emit(c, s_add_const(c, node->value));
+        s_stack(c, 1);
+        break;
+    case ln_ref:
+        s_emit(c, op_ref);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1);
+        break;
+    case ln_global:
+        s_emit(c, op_global);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1);
+        break;
+    case ln_local:
+        s_emit(c, op_local);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1);
+        break;
+    case ln_define:
+        s_compile(exec, c, node->argv[0], 0);
+        s_emit(c, op_define);
+        s_emit(c, s_add_const(c, node->value));
+        break;
+    case ln_lambda:
+        s_emit(c, op_lambda);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1);
+        break;
+    case ln_defmacro:
+        s_emit(c, op_macro);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1);
+        break;
+    case ln_begin:
+        for(index = 0; index < node->argc; index++) {
+            if(index) {
+                s_emit(c, op_pop);
+                s_stack(c, -1);
+            }
+            s_compile(exec, c, node->argv[index],
+                      tail && index == node->argc - 1);
+        }
+        break;
+    case ln_quasiquote:
+        for(index = 0; index < node->argc; index++) {
+            sub = node->argv[index];
+            s_compile(exec, c, sub->type == ln_splice ? sub->body : sub, 0);
+        }
+        if(node->body)
+            s_compile(exec, c, node->body, 0);
+
+        s_emit(c, op_quasi);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, 1 - (node->argc + (node->body ? 1 : 0)));
+        break;
+    case ln_if:
+        s_compile(exec, c, node->argv[0], 0);
+        s_emit(c, op_jumpf);
+        patch = s_emit(c, 0);
+        s_stack(c, -1);
+
+        s_compile(exec, c, node->argv[1], tail);
+        if(tail) {
+            /* return straight out of the branch */
+            s_emit(c, op_return);
+        } else {
+            s_emit(c, op_jump);
+            patch_end = s_emit(c, 0);
+        }
+        s_stack(c, -1);
+
+        c->code->ops[patch] = c->code->len;
+        s_compile(exec, c, node->argv[2], tail);
+        if(!tail)
+            c->code->ops[patch_end] = c->code->len;
+        break;
+    case ln_let:
+        for(index = 0; index < node->argc; index++)
+            s_compile(exec, c, node->argv[index], 0);
+
+        s_emit(c, op_let);
+        s_emit(c, s_add_node(c, node));
+        s_stack(c, -node->argc);
+
+        /* in tail position the env is dropped on return */
+        s_compile(exec, c, node->body, tail);
+        if(!tail)
+            s_emit(c, op_pop_env);
+        break;
+    case ln_let_star:
+        s_emit(c, op_push_env);
+        s_emit(c, s_add_node(c, node));
+
+        for(index = 0; index < node->argc; index++) {
+            s_compile(exec, c, node->argv[index], 0);
+            s_emit(c, op_bind);
+            s_emit(c, index);
+            s_stack(c, -1);
+        }
+
+        s_compile(exec, c, node->body, tail);
+        if(!tail)
+            s_emit(c, op_pop_env);
+        break;
+    case ln_set:
+        s_compile(exec, c, node->argv[0], 0);
+        s_emit(c, op_set);
+        s_emit(c, s_add_node(c, node));
+        break;
+    case ln_and:
+    case ln_or:
+        s_compile_logical(exec, c, node, tail);
+        break;
+    case ln_case:
+        s_compile_case(exec, c, node, tail);
+        break;
+    case ln_do:
+        s_compile_do(exec, c, node, tail);
+        break;
+    case ln_fold:
+        s_emit(c, op_fold);
+        s_emit(c, s_add_node(c, node));
+        patch = s_emit(c, 0);
+
+        /* otherwise, make the call */
+        s_compile_apply(exec, c, node);
+        c->code->ops[patch] = c->code->len;
+        break;
+    case ln_apply:
+        s_compile_apply(exec, c, node);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+/**
+ * compile an analyzed node into a standalone code object
+ * that returns the value of the node
+ */
+lcode_t *lisp_compile(lexec_t *exec, lnode_t *node) {
+    lcomp_t c;
+
+    assert(exec && node);
+
+    memset(&c, 0, sizeof(c));
+    c.code = safe_malloc(sizeof(lcode_t));
+
+    s_compile(exec, &c, node, 1);
+    s_emit(&c, op_return);
+
+    return c.code;
+}
+
+/**
+ * run inlined primitive op of call node on argv, for the argument
+ * types it handles in line.  Returns NULL for anything else, which
+ * is left to the primitive itself, errors included.
+ */
+static lv_t *s_inline(lexec_t *exec, lisp_inline_t op, lnode_t *node,
+                      lv_t *fn, lv_t **argv) {
+    lv_t *a0 = argv[0];
+    lv_t *a1 = s_inlines[op].argc > 1 ? argv[1] : NULL;
+
+    switch(op) {
+    case li_car:
+        if(a0->type != l_pair)
+            return NULL;
+        return L_CAR(a0);
+    case li_cdr:
+        if(a0->type != l_pair)
+            return NULL;
+        if(L_CDR(a0) == NULL)
+            return lisp_create_null();
+        return L_CDR(a0);
+    case li_cons:
+        return lisp_create_pair(a0, a1);
+    case li_nullp:
+        return lisp_create_bool(a0->type == l_null);
+    case li_pairp:
+        return lisp_create_bool(a0->type == l_pair);
+    default:
+        break;
+    }
+
+    /* the rest are arithmetic, run by the type feedback of the
+     * site */
+    return math_site_op(exec, &node->site, fn, 2, argv);
+}
+
+/**
+ * a vm frame: a code object being run, and what to put back
+ * when it returns.  Frames live on a heap stack rather than the
+ * C stack, so calls nest as deep as memory allows.
+ */
+typedef struct lvm_frame_t {
+    lcode_t *code;
+    int *pc;                // return point while a callee runs
+    int sp;                 // operand stack top while a callee runs
+    int base;               // operand stack bottom of the frame
+
+    /* context when the frame was entered */
+    lv_t *env;
+    lstack_t *env_stack;
+    lstack_t *eval_stack;
+    lregion_t region;
+} lvm_frame_t;
+
+/**
+ * make sure the operand stack has need slots
+ */
+static lv_t **s_reserve(lv_t **stack, int need, int *size) {
+    lv_t **pnew;
+    int used = *size;
+
+    if(need <= *size)
+        return stack;
+
+    while(*size < need)
+        *size = *size ? *size * 2 : 64;
+
+    pnew = safe_malloc(*size * sizeof(lv_t *));
+    if(stack)
+        memcpy(pnew, stack, used * sizeof(lv_t *));
+
+    return pnew;
+}
+
+/**
+ * push a frame whose operands start at base, saving the
+ * context it is entered from
+ */
+static lvm_frame_t *s_push_frame(lexec_t *exec, lvm_frame_t **frames,
+                                 int *count, int *size, int base) {
+    lvm_frame_t *f;
+
+    *frames = s_grow(*frames, *count, size, sizeof(lvm_frame_t));
+    f = &(*frames)[(*count)++];
+    f->base = base;
+    f->env = exec->env;
+    f->env_stack = exec->env_stack;
+    f->eval_stack = exec->eval_stack;
+    f->region = exec->region;
+
+    return f;
+}
+
+/**
+ * run an analyzed node to completion.  A call of a lambda
+ * pushes a frame and carries on with the callee's code in this
+ * same loop, and a return pops back to the caller, so lisp
+ * recursion doesn't recurse in C.  Only natives that call back
+ * into lisp start a new run.
+ */
+static lv_t *s_vm_run(lexec_t *exec, lnode_t *node) {
+    lvm_frame_t *frames = NULL, *f;
+    int nframes = 0, fsize = 0;
+    lv_t **stack = NULL;
+    int ssize = 0;
+    lcode_t *code;
+    lv_t **sp;
+    int *pc;
+    lv_t *v, *fn, *frame;
+    int count, op;
+
+    f = s_push_frame(exec, &frames, &nframes, &fsize, 0);
+
+enter:
+    /* start node in frame f, which has its context set up */
+    if(!node->code)
+        node->code = lisp_compile(exec, node);
+
+    code = f->code = node->code;
+    pc = code->ops;
+    stack = s_reserve(stack, f->base + code->depth + 1, &ssize);
+    sp = stack + f->base;
+
+    while(1) {
+        switch(*pc++) {
+        case op_const:
+            *sp++ = code->consts[*pc++];
+            break;
+        case op_ref:
+            *sp++ = lisp_dynamic_lookup(exec, code->nodes[*pc++]);
+            break;
+        case op_global:
+            node = code->nodes[*pc++];
+            if(node->cell && *node->cell) {
+                exec->ic_hits++;
+                *sp++ = *node->cell;
+            } else
+                *sp++ = lisp_global_lookup(exec, node);
+            break;
+        case op_local:
+            *sp++ = lisp_local_lookup(exec, code->nodes[*pc++]);
+            break;
+        case op_define:
+            v = code->consts[*pc++];
+            if(sp[-1]->type == l_fn && !L_FN_BOUND(sp[-1]))
+                L_FN_BOUND(sp[-1]) = v;
+            sp[-1] = lisp_define(exec, v, sp[-1]);
+            break;
+        case op_lambda:
+        case op_macro:
+            /* these nodes evaluate nothing, so the tree handler
+             * does exactly what we need */
+            *sp++ = lisp_exec_node(exec, code->nodes[*pc++]);
+            break;
+        case op_pop:
+            sp--;
+            break;
+        case op_jump:
+            pc = code->ops + *pc;
+            break;
+        case op_jumpf:
+            v = *--sp;
+            if(v == LISP_FALSE)
+                pc = code->ops + *pc;
+            else
+                pc++;
+            break;
+        case op_jumpf_keep:
+            v = sp[-1];
+            if(v == LISP_FALSE) {
+                pc = code->ops + *pc;
+            } else {
+                sp--;
+                pc++;
+            }
+            break;
+        case op_jumpt_keep:
+            v = sp[-1];
+            if(v != LISP_FALSE) {
+                pc = code->ops + *pc;
+            } else {
+                sp--;
+                pc++;
+            }
+            break;
+        case op_case:
+            node = code->nodes[*pc++];
+            v = *--sp;
+            pc = code->ops + pc[lisp_case_select(exec, node, v)];
+            break;
+        case op_set:
+            node = code->nodes[*pc++];
+            sp[-1] = lisp_set_node(exec, node, sp[-1]);
+            break;
+        case op_macro_check:
+            node = code->nodes[*pc++];
+            fn = sp[-1];
+            if(fn->type == l_fn && L_FN_FTYPE(fn) == lf_macro) {
+                node = lisp_expand_node(exec, node, fn);
+                if(code->ops[*pc] == op_return) {
+                    lisp_tail_node(exec, node);
+                    goto tail;
+                }
+
+                /* run the expansion in a frame of its own, with
+                 * the result landing in place of the macro */
+                f->pc = code->ops + *pc;
+                f->sp = sp - stack;
+                f = s_push_frame(exec, &frames, &nframes, &fsize, f->sp);
+                goto enter;
+            }
+            pc++;
+            break;
+        case op_fold:
+            node = code->nodes[*pc++];
+            if(lisp_fold_valid(exec, node)) {
+                *sp++ = node->value;
+                pc = code->ops + *pc;
+            } else {
+                pc++;
+            }
+            break;
+        case op_inline:
+            op = *pc++;
+            node = code->nodes[*pc++];
+            count = s_inlines[op].argc;
+            fn = sp[-count - 1];
+            if(fn->type == l_fn && L_FN_FTYPE(fn) == lf_native &&
+               L_FN_ARGV(fn) == s_inlines[op].fn &&
+               (v = s_inline(exec, op, node, fn, sp - count))) {
+                sp -= count;
+                sp[-1] = v;
+                break;
+            }
+            goto call;
+        case op_call:
+            count = *pc++;
+        call:
+            sp -= count;
+            fn = sp[-1];
+
+            rt_assert(fn->type == l_fn, le_type, "eval a non-function");
+
+            if(L_FN_FTYPE(fn) == lf_lambda) {
+                lisp_check_arity(exec, fn, count);
+                lisp_tail_call(exec, fn, c_array_to_list(count, sp));
+                if(*pc == op_return)
+                    goto tail;
+
+                /* a call: the callee's operands go over the
+                 * arguments, which have been copied out */
+                f->pc = pc;
+                f->sp = sp - stack;
+                f = s_push_frame(exec, &frames, &nframes, &fsize, f->sp);
+                node = lisp_tail_enter(exec, f->env_stack,
+                                       f->eval_stack, &f->region);
+                goto enter;
+            }
+
+            /* natives taking an argument vector get the
+             * arguments straight off the operand stack */
+            sp[-1] = lisp_exec_argv(exec, fn, count, sp);
+            break;
+        case op_quasi:
+            node = code->nodes[*pc++];
+            sp -= node->argc + (node->body ? 1 : 0);
+            *sp = lisp_quasi_build(exec, node, sp);
+            sp++;
+            break;
+        case op_let:
+            node = code->nodes[*pc++];
+            count = node->type == ln_do ? (node->argc - 3) / 2 : node->argc;
+            sp -= count;
+            frame = lisp_create_frame(node->scope);
+            memcpy(L_FRAME_SLOTS(frame), sp, count * sizeof(lv_t *));
+            lisp_exec_push_env(exec, lisp_create_pair(frame, exec->env));
+            break;
+        case op_rebind:
+            node = code->nodes[*pc++];
+            count = (node->argc - 3) / 2;
+            sp -= count;
+            frame = lisp_create_frame(node->scope);
+            memcpy(L_FRAME_SLOTS(frame), sp, count * sizeof(lv_t *));
+            lisp_exec_pop_env(exec);
+            lisp_exec_push_env(exec, lisp_create_pair(frame, exec->env));
+            break;
+        case op_push_env:
+            frame = lisp_create_frame(code->nodes[*pc++]->scope);
+            lisp_exec_push_env(exec, lisp_create_pair(frame, exec->env));
+            break;
+        case op_bind:
+            L_FRAME_SLOT(L_CAR(exec->env), *pc++) = *--sp;
+            break;
+        case op_pop_env:
+            lisp_exec_pop_env(exec);
+            break;
+        case op_return:
+            v = sp[-1];
+            exec->env = f->env;
+            exec->env_stack = f->env_stack;
+            exec->eval_stack = f->eval_stack;
+            lisp_region_release(exec, &f->region);
+
+            if(--nframes == 0)
+                return v;
+
+            f = &frames[nframes - 1];
+            code = f->code;
+            pc = f->pc;
+            sp = stack + f->sp;
+            sp[-1] = v;
+            break;
+        default:
+            assert(0);
+        }
+    }
+
+tail:
+    /* a tail request replaces the running frame */
+    node = lisp_tail_enter(exec, f->env_stack, f->eval_stack, &f->region);
+    goto enter;
+}
+
+/**
+ * run an analyzed node on the vm, compiling it on first use
+ */
+lv_t *lisp_vm_exec(lexec_t *exec, lnode_t *node) {
+    assert(exec && node);
+
+    return s_vm_run(exec, node);
+}
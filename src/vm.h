@@ -0,0 +1,80 @@
+/*
+ * Simple lisp interpreter
+ *
+ * Copyright (C) 2014 Ron Pedde (ron@pedde.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _VM_H_
+#define _VM_H_
+
+#define LISP_OPS \
+    C(op_const)       /* k: push constant k */ \
+    C(op_ref)         /* k: push value of ref node k, looked up by name */ \
+    C(op_local)       /* k: push value of local node k */ \
+    C(op_global)      /* k: push value of global node k */ \
+    C(op_define)      /* k: define symbol constant k to top of stack */ \
+    C(op_lambda)      /* k: push closure of lambda node k */ \
+    C(op_macro)       /* k: define macro from defmacro node k */ \
+    C(op_pop)         /* discard top of stack */ \
+    C(op_jump)        /* off: jump */ \
+    C(op_jumpf)       /* off: pop, and jump if #f */ \
+    C(op_jumpf_keep)  /* off: jump if #f, else pop */ \
+    C(op_jumpt_keep)  /* off: jump unless #f, else pop */ \
+    C(op_case)        /* k, offs: pop key, and jump by the clause of \
+                         case node k it selects */ \
+    C(op_macro_check) /* k, off: expand apply node k if operator is a macro */ \
+    C(op_fold)        /* k, off: push the value of fold node k and jump, \
+                         if the fold still holds */ \
+    C(op_call)        /* n: call function under n args, as a tail call \
+                         if the next op is op_return */ \
+    C(op_inline)      /* i, k: run primitive i of call node k on the \
+                         args above it in line, if the function under \
+                         them is still that primitive, else op_call */ \
+    C(op_quasi)       /* k: build quasiquote node k from stack */ \
+    C(op_let)         /* k: pop inits of let node k into a new frame */ \
+    C(op_push_env)    /* k: push an empty frame for let* node k */ \
+    C(op_bind)        /* n: pop into slot n of the top frame */ \
+    C(op_rebind)      /* k: pop the steps of do node k into a new frame, \
+                         replacing the top one */ \
+    C(op_set)         /* k: set! the target of node k to top of stack */ \
+    C(op_pop_env)     /* drop top env layer */ \
+    C(op_return)      /* return top of stack */
+
+#define C(x) x,
+typedef enum lisp_op_t { LISP_OPS op_max } lisp_op_t;
+#undef C
+
+extern char *lisp_ops_list[];
+
+/**
+ * compiled code for one node.  The instruction stream is
+ * opcodes followed by their operands.
+ */
+struct lcode_t {
+    int *ops;
+    int len;
+    lv_t **consts;
+    int nconsts;
+    lnode_t **nodes;
+    int nnodes;
+    int depth;      // max operand stack depth
+};
+
+extern lcode_t *lisp_compile(lexec_t *exec, lnode_t *node);
+extern lv_t *lisp_vm_exec(lexec_t *exec, lnode_t *node);
+
+#endif /* _VM_H_ */